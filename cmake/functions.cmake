@@ -15,10 +15,11 @@ function(suppress_warnings TARGET_NAME)
                                                 ${target_options})
 endfunction()
 
+# Extra arguments are passed to glslc, e.g. -DNAME to compile another variant of the shader
 function(add_spirv_shader TARGET_NAME INPUT_FILE)
     add_custom_command(
         OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${TARGET_NAME}.spv
-        COMMAND ${glslc} -c ${INPUT_FILE} -o
+        COMMAND ${glslc} ${ARGN} -c ${INPUT_FILE} -o
                 ${CMAKE_CURRENT_BINARY_DIR}/${TARGET_NAME}.spv
         MAIN_DEPENDENCY ${INPUT_FILE}
         WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR})
@@ -1,45 +1,588 @@
+#include "chunk/chunk_gen.h"
 #include "chunk/chunk_man.h"
 #include "chunk/chunk_mesher.h"
+#include "chunk/edit_transaction.h"
+#include "chunk/face_masks.h"
+#include "chunk/mesh_registry.h"
+#include <array>
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+using Blocks = std::array<chunk::BlockID, chunk::Chunk::k_block_count>;
+
+// Noise is seeded with the constant, so the benchmarks are run on the same world every time
+constexpr uint32_t k_benchmark_seed = 1337;
+
+// Unpack the chunk into the plain array ordered by the layout
+template <typename Layout>
+void
+decodeWithLayout( const chunk::Chunk& chunk, Blocks& blocks )
+{
+    static Blocks chunk_blocks{};
+    chunk.decode( chunk_blocks );
+
+    for ( int x = 0; x < chunk::Chunk::k_max_width_length; x++ )
+    {
+        for ( int y = 0; y < chunk::Chunk::k_max_width_length; y++ )
+        {
+            for ( int z = 0; z < chunk::Chunk::k_max_height; z++ )
+            {
+                blocks[ chunk::Chunk::toIndex<Layout>( x, y, z ) ] = chunk_blocks[ chunk::Chunk::toIndex( x, y, z ) ];
+            }
+        }
+    }
+}
+
+// Extract all the planes of the chunk along the axis, like the mesher does. Return the elapsed time in millis
+template <typename Layout>
+float
+sweepAxis( const Blocks& blocks, int axis, std::size_t& checksum )
+{
+    static std::array<chunk::BlockID, chunk::Chunk::k_max_slice_size> slice{};
+    const auto coords_count = ( axis == 2 ) ? chunk::Chunk::k_max_height : chunk::Chunk::k_max_width_length;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    for ( int coord = 0; coord < coords_count; coord++ )
+    {
+        chunk::Chunk::extractSlice<Layout>( blocks, axis, coord, 0, chunk::Chunk::k_max_height, slice );
+        checksum += utils::toUnderlying( slice[ coord ] );
+    }
+
+    auto finish_time = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<float, std::chrono::milliseconds::period>( finish_time - start_time ).count();
+}
+
+// Compare the cost of the sweeps over the region along every axis in the linear and Morton layouts
+void
+benchmarkLayouts( const chunk::ChunkMan& chunk_man )
+{
+    static Blocks linear_blocks{};
+    static Blocks morton_blocks{};
+
+    std::array<float, 3> linear_times{};
+    std::array<float, 3> morton_times{};
+    std::size_t checksum = 0;
+
+    const auto origin = chunk_man.getOriginPos();
+    const auto render_distance = chunk_man.getRenderDistance();
+
+    for ( int x = -render_distance; x <= render_distance; x++ )
+    {
+        for ( int y = -render_distance; y <= render_distance; y++ )
+        {
+            const auto& chunk = chunk_man.getChunk( origin + pos::ChunkPos{ x, y } );
+            decodeWithLayout<chunk::LinearLayout>( chunk, linear_blocks );
+            decodeWithLayout<chunk::MortonLayout>( chunk, morton_blocks );
+
+            for ( int axis = 0; axis < 3; axis++ )
+            {
+                linear_times[ axis ] += sweepAxis<chunk::LinearLayout>( linear_blocks, axis, checksum );
+                morton_times[ axis ] += sweepAxis<chunk::MortonLayout>( morton_blocks, axis, checksum );
+            }
+        }
+    }
+
+    std::cout << "[Layout] chunks are stored in the " << chunk::BlockLayout::k_name << " layout\n";
+
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        std::cout << "[Layout] sweep along " << "XYZ"[ axis ] << ": linear " << linear_times[ axis ]
+                  << " millis, morton " << morton_times[ axis ] << " millis\n";
+    }
+
+    std::cout << "[Layout] checksum: " << checksum << "\n";
+}
+
+// Mesh the region with every meshing mode and check that they make the same meshes as the default one
+void
+compareMeshingModes( const chunk::MeshRegistry& default_registry )
+{
+    using MeshingMode = chunk::ChunkMesher::MeshingMode;
+    const auto default_mode = chunk::ChunkMesher::getMeshingMode();
+
+    const std::array modes = {
+        std::pair{ MeshingMode::k_greedy, "greedy" },
+        std::pair{ MeshingMode::k_greedy_fixed_axes, "greedy with fixed axes" },
+        std::pair{ MeshingMode::k_binary, "binary" } };
+
+    for ( auto [ mode, name ] : modes )
+    {
+        chunk::ChunkMesher::setMeshingMode( mode );
+
+        auto start_time = std::chrono::high_resolution_clock::now();
+
+        chunk::MeshRegistry registry{};
+        registry.applyUpdate( registry.collectUpdate() );
+
+        auto finish_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_time =
+            std::chrono::duration<float, std::chrono::milliseconds::period>( finish_time - start_time ).count();
+
+        const auto is_same_data = []( const auto& lhs, const auto& rhs ) {
+            const auto lhs_bytes = std::as_bytes( std::span{ lhs } );
+            const auto rhs_bytes = std::as_bytes( std::span{ rhs } );
+            return lhs_bytes.size() == rhs_bytes.size() &&
+                std::memcmp( lhs_bytes.data(), rhs_bytes.data(), lhs_bytes.size() ) == 0;
+        };
+
+        bool is_same = registry.getMeshes().size() == default_registry.getMeshes().size();
+
+        for ( const auto& [ position, mesh ] : registry.getMeshes() )
+        {
+            const auto* default_mesh = default_registry.findMesh( position );
+            is_same = is_same && default_mesh != nullptr && is_same_data( mesh.vertices, default_mesh->vertices ) &&
+                is_same_data( mesh.indices, default_mesh->indices ) &&
+                is_same_data( mesh.wide_indices, default_mesh->wide_indices ) &&
+                is_same_data( mesh.face_ranges, default_mesh->face_ranges );
+        }
+
+        std::cout << "[Meshing] " << name << " mode: " << elapsed_time << " millis, same mesh: " << std::boolalpha
+                  << is_same << "\n";
+    }
+
+    chunk::ChunkMesher::setMeshingMode( default_mode );
+}
+
+// Mesh the region into the quads and check that the triangles made from them like the vertex shader does are
+// the same as the indexed ones of the default format. Both formats are compared by the memory of the meshes
+void
+compareMeshFormats( const chunk::MeshRegistry& default_registry )
+{
+    using MeshFormat = chunk::ChunkMesher::MeshFormat;
+    using Corner = std::array<int, 6>; // x, y, z, u, v, block id
+
+    // Triangles of the front and the back faces, see vertex_shader.vert
+    constexpr std::array<int, 6> k_front_corners = { 0, 1, 2, 1, 3, 2 };
+    constexpr std::array<int, 6> k_back_corners = { 2, 3, 1, 2, 1, 0 };
+
+    chunk::ChunkMesher::setMeshFormat( MeshFormat::k_quads );
+
+    chunk::MeshRegistry registry{};
+    registry.applyUpdate( registry.collectUpdate() );
+
+    chunk::ChunkMesher::setMeshFormat( MeshFormat::k_vertices );
+
+    bool is_same = registry.getMeshes().size() == default_registry.getMeshes().size();
+
+    for ( const auto& [ position, mesh ] : registry.getMeshes() )
+    {
+        const auto* default_mesh = default_registry.findMesh( position );
+        if ( !default_mesh || default_mesh->getIndicesCount() != mesh.quads.size() * k_front_corners.size() )
+        {
+            is_same = false;
+            continue;
+        }
+
+        // quads of every direction are expanded to the same range of the indices
+        for ( std::size_t direction = 0; direction < chunk::ChunkMesher::k_directions_count; direction++ )
+        {
+            const auto& range = mesh.face_ranges[ direction ];
+            const auto& default_range = default_mesh->face_ranges[ direction ];
+
+            is_same = is_same && range.first * k_front_corners.size() == default_range.first &&
+                range.count * k_front_corners.size() == default_range.count;
+        }
+
+        for ( std::size_t quad_index = 0; quad_index < mesh.quads.size(); quad_index++ )
+        {
+            const auto& quad = mesh.quads[ quad_index ];
+            const auto& corners = quad.position.is_front_face ? k_front_corners : k_back_corners;
+
+            for ( std::size_t corner_index = 0; corner_index < corners.size(); corner_index++ )
+            {
+                const int du = corners[ corner_index ] & 1;
+                const int dv = corners[ corner_index ] >> 1;
+
+                std::array<int, 3> quad_position = {
+                    static_cast<int>( quad.position.x ),
+                    static_cast<int>( quad.position.y ),
+                    static_cast<int>( quad.position.z ) };
+                quad_position[ ( quad.position.dim + 1 ) % 3 ] += du * quad.tex_descr.u;
+                quad_position[ ( quad.position.dim + 2 ) % 3 ] += dv * quad.tex_descr.v;
+
+                const auto quad_corner = Corner{
+                    quad_position[ 0 ],
+                    quad_position[ 1 ],
+                    quad_position[ 2 ],
+                    du * quad.tex_descr.u,
+                    dv * quad.tex_descr.v,
+                    quad.tex_descr.block_id };
+
+                const auto index = default_mesh->getIndex( quad_index * corners.size() + corner_index );
+                const auto& vertex = default_mesh->vertices[ index ];
+
+                const auto vertex_corner = Corner{
+                    vertex.position.x,
+                    vertex.position.y,
+                    vertex.position.z,
+                    vertex.tex_descr.u,
+                    vertex.tex_descr.v,
+                    vertex.tex_descr.block_id };
+
+                is_same = is_same && quad_corner == vertex_corner;
+            }
+        }
+    }
+
+    std::cout << "[Formats] quads count: " << registry.getQuadsCount() << ", quads ( in KiloBytes ): "
+              << registry.getAllocatedBytesCount() / 1024
+              << ", vertices and indices ( in KiloBytes ): " << default_registry.getAllocatedBytesCount() / 1024
+              << ", same triangles: " << std::boolalpha << is_same << "\n";
+}
+
+// Count the indices of the faces turned away from the camera above the origin, they aren't drawn at all
+void
+countCulledFaces( const chunk::MeshRegistry& registry )
+{
+    constexpr float k_camera_x = 8.0f;
+    constexpr float k_camera_y = 8.0f;
+    constexpr float k_camera_z = 100.0f;
+
+    std::size_t culled_count = 0;
+
+    for ( const auto& [ position, mesh ] : registry.getMeshes() )
+    {
+        for ( std::size_t direction = 0; direction < chunk::ChunkMesher::k_directions_count; direction++ )
+        {
+            if ( !mesh.bounds.isFacing( direction, k_camera_x, k_camera_y, k_camera_z ) )
+            {
+                culled_count += mesh.face_ranges[ direction ].count;
+            }
+        }
+    }
+
+    std::cout << "[Culling] indices turned away from the camera: " << culled_count << " of "
+              << registry.getIndicesCount() << "\n";
+}
+
+// Count the meshes with the wide indices and compare the memory of the indices with the one all of them would take,
+// if they were 32 bits wide
+void
+countWideIndices( const chunk::MeshRegistry& registry )
+{
+    std::size_t wide_meshes_count = 0;
+    std::size_t indices_bytes = 0;
+
+    for ( const auto& [ position, mesh ] : registry.getMeshes() )
+    {
+        wide_meshes_count += mesh.wide_indices.empty() ? 0 : 1;
+        indices_bytes += mesh.indices.size() * sizeof( uint16_t ) + mesh.wide_indices.size() * sizeof( uint32_t );
+    }
+
+    std::cout << "[Indices] meshes with 32-bit indices: " << wide_meshes_count << " of " << registry.getMeshes().size()
+              << ", indices ( in KiloBytes ): " << indices_bytes / 1024
+              << ", all 32-bit ( in KiloBytes ): " << registry.getIndicesCount() * sizeof( uint32_t ) / 1024 << "\n";
+}
+
+// Mesh every chunk of the region by the greedy mesher with the sweeps specialized for the axes and with the axes
+// chosen at run time. Neighbours are read once, so only the meshing itself is measured. Chunks are meshed once before
+// the measurement and the variants take turns to go first, so neither of them warms the caches for the other
+void
+benchmarkGreedyAxes( const chunk::ChunkMan& chunk_man )
+{
+    using Mesher = chunk::ChunkMesher;
+
+    constexpr int k_repeats_count = 5;
+
+    static Mesher::NeighbourSides neighbour_sides{};
+    Mesher::MesherContext context{};
+
+    float fixed_time = 0;
+    float runtime_time = 0;
+
+    const auto origin = chunk_man.getOriginPos();
+    const auto render_distance = chunk_man.getRenderDistance();
+
+    auto measure = [ & ]( auto mesh, const chunk::Chunk& chunk ) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+
+        for ( int repeat = 0; repeat < k_repeats_count; repeat++ )
+        {
+            mesh( chunk, neighbour_sides, context );
+        }
+
+        auto finish_time = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<float, std::chrono::milliseconds::period>( finish_time - start_time ).count();
+    };
+
+    for ( int x = -render_distance; x <= render_distance; x++ )
+    {
+        for ( int y = -render_distance; y <= render_distance; y++ )
+        {
+            const auto position = origin + pos::ChunkPos{ x, y };
+            const auto& chunk = chunk_man.getChunk( position );
+            const auto heights = chunk.getHeightRange();
+
+            Mesher::readNeighbourSides( position, heights.begin, heights.end, neighbour_sides );
+
+            Mesher::greedyMesh( chunk, neighbour_sides, context );
+
+            if ( ( x + y ) % 2 == 0 )
+            {
+                fixed_time += measure( Mesher::greedyMeshFixedAxes, chunk );
+                runtime_time += measure( Mesher::greedyMesh, chunk );
+            } else
+            {
+                runtime_time += measure( Mesher::greedyMesh, chunk );
+                fixed_time += measure( Mesher::greedyMeshFixedAxes, chunk );
+            }
+        }
+    }
+
+    std::cout << "[Axes] greedy mesher, " << k_repeats_count << " times over the region with seed " << k_benchmark_seed
+              << ": fixed axes " << fixed_time << " millis, runtime axes " << runtime_time << " millis\n";
+}
+
+// Build the face masks of the neighbouring planes of the region with every instruction set supported by the CPU
+// and check that they are the same as the scalar ones
+void
+benchmarkFaceMasks( const chunk::ChunkMan& chunk_man )
+{
+    constexpr int k_repeats_count = 20;
+    constexpr auto k_size = chunk::Chunk::k_max_slice_size;
+
+    using Plane = std::array<chunk::BlockID, k_size>;
+
+    struct Masks
+    {
+        std::array<bool, k_size> cmp;
+        std::array<bool, k_size> normal;
+        Plane face;
+    };
+
+    const std::array isas = {
+        std::pair{ chunk::FaceMasksIsa::k_scalar, "scalar" },
+        std::pair{ chunk::FaceMasksIsa::k_sse41, "sse4.1" },
+        std::pair{ chunk::FaceMasksIsa::k_avx2, "avx2" } };
+
+    static std::array<Plane, 2> planes{};
+    static std::array<Masks, isas.size()> masks{};
+
+    std::array<float, isas.size()> times{};
+    bool is_same = true;
+
+    const auto default_isa = chunk::getFaceMasksIsa();
+    const auto supported_isa = chunk::getSupportedFaceMasksIsa();
+
+    const auto origin = chunk_man.getOriginPos();
+    const auto render_distance = chunk_man.getRenderDistance();
+
+    for ( int x = -render_distance; x <= render_distance; x++ )
+    {
+        for ( int y = -render_distance; y <= render_distance; y++ )
+        {
+            const auto& chunk = chunk_man.getChunk( origin + pos::ChunkPos{ x, y } );
+
+            // the planes orthogonal to X in the middle of the chunk, whole height of the chunk
+            chunk.readSlice( 0, 7, 0, chunk::Chunk::k_max_height, planes[ 0 ] );
+            chunk.readSlice( 0, 8, 0, chunk::Chunk::k_max_height, planes[ 1 ] );
+
+            for ( std::size_t isa = 0; isa < isas.size() && isas[ isa ].first <= supported_isa; isa++ )
+            {
+                chunk::setFaceMasksIsa( isas[ isa ].first );
+                auto& isa_masks = masks[ isa ];
+
+                auto start_time = std::chrono::high_resolution_clock::now();
+
+                for ( int repeat = 0; repeat < k_repeats_count; repeat++ )
+                {
+                    chunk::buildFaceMasks(
+                        planes[ 0 ],
+                        planes[ 1 ],
+                        false,
+                        false,
+                        { .cmp = isa_masks.cmp, .normal = isa_masks.normal, .face = isa_masks.face } );
+                }
+
+                auto finish_time = std::chrono::high_resolution_clock::now();
+                times[ isa ] +=
+                    std::chrono::duration<float, std::chrono::milliseconds::period>( finish_time - start_time ).count();
+
+                is_same = is_same && isa_masks.cmp == masks[ 0 ].cmp && isa_masks.normal == masks[ 0 ].normal &&
+                    isa_masks.face == masks[ 0 ].face;
+            }
+        }
+    }
+
+    chunk::setFaceMasksIsa( default_isa );
+
+    for ( std::size_t isa = 0; isa < isas.size() && isas[ isa ].first <= supported_isa; isa++ )
+    {
+        std::cout << "[Face masks] " << isas[ isa ].second << ": " << times[ isa ] << " millis\n";
+    }
+
+    std::cout << "[Face masks] same masks: " << std::boolalpha << is_same << "\n";
+}
+
+} // namespace
 
 int
-main()
+main( int argc, char** argv )
 {
+    chunk::setGenerationSeed( k_benchmark_seed );
+
+    // Render distance can be passed as the first argument
+    if ( argc > 1 )
+    {
+        chunk::ChunkMan::setInitialRenderDistance( std::stoi( argv[ 1 ] ) );
+    }
+
     // or decltype( auto )
     auto& chunk_man = chunk::ChunkMan::getRef();
 
-    std::cout << "Render distance: " << chunk::ChunkMan::k_render_distance << std::endl;
-    std::cout << "Chunks in ChunkMan: " << chunk::ChunkMan::k_chunks_count << std::endl;
+    std::cout << "Render distance: " << chunk_man.getRenderDistance() << std::endl;
+    std::cout << "Chunks in ChunkMan: " << chunk_man.getChunksCount() << std::endl;
+
+    std::cout << "Plain block array size (in MegaBytes ): "
+              << ( chunk_man.getChunksCount() * chunk::Chunk::k_block_count * sizeof( chunk::BlockID ) ) /
+            ( 1024 * 1024 )
+              << std::endl;
 
-    std::cout << "Allocated chunk_man size (in MegaBytes ): "
-              << ( chunk::ChunkMan::k_blocks_count * sizeof( chunk::BlockID ) ) / ( 1024 * 1024 ) << std::endl;
+    std::cout << "Allocated chunk_man size (in KiloBytes ): " << chunk_man.getAllocatedBytesCount() / 1024
+              << std::endl;
+
+    auto sections_stats = chunk_man.getSectionsStats();
+    std::cout << "Sections: absent = " << sections_stats.absent_count
+              << ", uniform = " << sections_stats.uniform_count << ", dense = " << sections_stats.dense_count
+              << std::endl;
 
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    chunk::ChunkMesher mesher{};
-    mesher.meshRenderArea();
+    chunk::MeshRegistry registry{};
+    registry.applyUpdate( registry.collectUpdate() );
+    registry.markUploaded();
 
     auto finish_time = std::chrono::high_resolution_clock::now();
     auto elapsed_time =
         std::chrono::duration<float, std::chrono::milliseconds::period>( finish_time - start_time ).count();
 
-    std::cout << "[Meshing] vertices count: " << mesher.getVerticesCount() << "\n"
-              << "indices count: " << mesher.getIndicesCount() << "\n";
+    std::cout << "[Meshing] meshes count: " << registry.getMeshes().size() << "\n"
+              << "vertices count: " << registry.getVerticesCount() << "\n"
+              << "indices count: " << registry.getIndicesCount() << "\n";
 
-    std::cout << "[Meshing] allocated memory ( in MegaBytes ): " << mesher.getAllocatedBytesCount() / ( 1024 * 1024 )
+    std::cout << "[Meshing] allocated memory ( in MegaBytes ): " << registry.getAllocatedBytesCount() / ( 1024 * 1024 )
               << "\n";
 
     std::cout << "[Meshing] elapsed time: " << elapsed_time << " millis\n";
 
+    compareMeshingModes( registry );
+    compareMeshFormats( registry );
+    countCulledFaces( registry );
+    countWideIndices( registry );
+    benchmarkGreedyAxes( chunk_man );
+    benchmarkFaceMasks( chunk_man );
+    benchmarkLayouts( chunk_man );
+
     // Move "forward" ( along the Y axis )
     for ( int i = 0; i <= 100; i++ )
     {
         chunk_man.changeOriginPos( { 0, i } );
     }
 
-    auto get_chunk = chunk_man.getChunk( { -12, 100 } );
+    // Teleport far away and move diagonally, only chunks that are new for the region are generated
+    chunk_man.changeOriginPos( { 1000, -1000 } );
+    chunk_man.changeOriginPos( { 1001, -999 } );
+    chunk_man.changeOriginPos( { 0, 100 } );
+
+    // Pace back and forth across the chunk border, the row coming back is taken from the cache
+    for ( int i = 0; i < 10; i++ )
+    {
+        chunk_man.changeOriginPos( { 0, 101 } );
+        chunk_man.changeOriginPos( { 0, 100 } );
+    }
+
+    const auto& cache = chunk_man.getCache();
+    std::cout << "[Cache] used ( in KiloBytes ): " << cache.getUsedBytes() / 1024 << ", hits: " << cache.getHitsCount()
+              << ", misses: " << cache.getMissesCount() << "\n";
+
+    // Shrink and grow the region back, only the outer ring of chunks is generated again
+    chunk_man.setRenderDistance( chunk_man.getRenderDistance() / 2 + 1 );
+    chunk_man.setRenderDistance( chunk::ChunkMan::k_default_render_distance );
+
+    const auto& get_chunk = chunk_man.getChunk( { -10, 100 } );
     auto block_id = get_chunk.at( 5, 5, 3 );
 
+    std::cout << "Block id at ( 5, 5, 3 ) of chunk ( -10, 100 ): " << utils::toUnderlying( block_id ) << "\n";
+
+    // Only the chunks that entered the region and their neighbours are meshed, the rest of the meshes are kept
+    start_time = std::chrono::high_resolution_clock::now();
+    auto update = registry.collectUpdate();
+    finish_time = std::chrono::high_resolution_clock::now();
+    elapsed_time = std::chrono::duration<float, std::chrono::milliseconds::period>( finish_time - start_time ).count();
+
+    std::cout << "[Moving] remeshed chunks: " << update.meshes.size() << ", removed meshes: " << update.removed.size()
+              << ", elapsed time: " << elapsed_time << " millis\n";
+
+    registry.applyUpdate( std::move( update ) );
+    registry.markUploaded();
+
+    // Dig a well through the corner of the chunk ( 0, 100 ), only it and its neighbours are remeshed
+
+    for ( int z = 0; z < chunk::Chunk::k_max_height; z++ )
+    {
+        chunk_man.setBlock( { 0, 100 * chunk::Chunk::k_max_width_length, z }, chunk::BlockID::k_none );
+    }
+
+    start_time = std::chrono::high_resolution_clock::now();
+    update = registry.collectUpdate();
+    finish_time = std::chrono::high_resolution_clock::now();
+    elapsed_time = std::chrono::duration<float, std::chrono::milliseconds::period>( finish_time - start_time ).count();
+
+    std::cout << "[Editing] remeshed chunks: " << update.meshes.size() << ", elapsed time: " << elapsed_time
+              << " millis\n";
+
+    registry.applyUpdate( std::move( update ) );
+    registry.markUploaded();
+
+    // Copy a 64x64x128 structure and paste it twice with a hollow sphere next to it by one transaction
+    start_time = std::chrono::high_resolution_clock::now();
+
+    const auto structure = chunk::EditTransaction::copy( { -64, 1536, 0 }, { -1, 1599, 127 } );
+
+    chunk::EditTransaction transaction;
+    transaction.paste( structure, { 0, 1600, 64 } );
+    transaction.paste( structure, { 32, 1632, 96 }, true );
+    transaction.fillSphere( { -40, 1640, 100 }, 24, chunk::BlockID::k_stone );
+    transaction.fillSphere( { -40, 1640, 100 }, 20, chunk::BlockID::k_none );
+    const auto changed_count = transaction.commit();
+
+    finish_time = std::chrono::high_resolution_clock::now();
+    elapsed_time = std::chrono::duration<float, std::chrono::milliseconds::period>( finish_time - start_time ).count();
+
+    std::cout << "[Transaction] changed chunks: " << changed_count << ", elapsed time: " << elapsed_time
+              << " millis\n";
+
+    start_time = std::chrono::high_resolution_clock::now();
+    update = registry.collectUpdate();
+    finish_time = std::chrono::high_resolution_clock::now();
+    elapsed_time = std::chrono::duration<float, std::chrono::milliseconds::period>( finish_time - start_time ).count();
+
+    std::cout << "[Transaction] remeshed chunks: " << update.meshes.size()
+              << ", elapsed time: " << elapsed_time << " millis\n";
+
+    registry.applyUpdate( std::move( update ) );
+    registry.markUploaded();
+
+    // Edits writing the same blocks change nothing: the sky has no stone to replace, air is pasted over air
+    const auto air = chunk::BlockRegion{ 48, 48, 32 };
+
+    chunk::EditTransaction noop_transaction;
+    noop_transaction.replace( { -64, 1536, 200 }, { 63, 1663, 255 }, chunk::BlockID::k_stone, chunk::BlockID::k_dirt );
+    noop_transaction.paste( air, { -24, 1576, 220 } );
+    noop_transaction.fillSphere( { 0, 1600, 230 }, 16, chunk::BlockID::k_none );
+    const auto noop_changed_count = noop_transaction.commit();
+
+    std::cout << "[Transaction] changed chunks by the edits without changes: " << noop_changed_count
+              << ", remeshed chunks: " << registry.collectUpdate().meshes.size() << "\n";
+
     return 0;
 }
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+namespace chunk
+{
+
+enum class BlockID : uint16_t
+{
+
+#define REGISTER_BLOCK( block_name, ... ) k_##block_name,
+#include "detail/block_id.inc"
+#undef REGISTER_BLOCK
+}; // enum class BlockID
+
+}; // namespace chunk
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "chunk/position.h"
+
+namespace chunk
+{
+
+/*
+ * Order of the blocks inside the 16x16x16 section of the chunk. Code that unpacks the sections indexes them
+ * with Chunk::toIndex(), so it doesn't depend on the layout. The layout is chosen at the build time
+ * with the CHUNK_MORTON_LAYOUT option.
+ */
+
+// Blocks are ordered as x, y, z ( z is the fastest ). Columns are contiguous, but the neighbours along X and Y
+// are 256 and 16 blocks apart
+struct LinearLayout
+{
+    static constexpr auto k_name = "linear";
+    static constexpr auto k_is_linear = true;
+
+    static constexpr int toSectionIndex( int x, int y, int z ) { return 256 * x + 16 * y + z; }
+
+    static constexpr pos::BlockPos toSectionPos( int index )
+    {
+        return pos::BlockPos{ .x = index / 256, .y = ( index / 16 ) % 16, .z = index % 16 };
+    }
+}; // struct LinearLayout
+
+// Bits of the coordinates are interleaved ( ... x1 y1 z1 x0 y0 z0 ), so every 2x2x2, 4x4x4 and 8x8x8 cube
+// of blocks is contiguous and the neighbours along all the axes are close to each other
+struct MortonLayout
+{
+    static constexpr auto k_name = "morton";
+    static constexpr auto k_is_linear = false;
+
+    static constexpr int toSectionIndex( int x, int y, int z )
+    {
+        return ( spreadBits( x ) << 2 ) | ( spreadBits( y ) << 1 ) | spreadBits( z );
+    }
+
+    static constexpr pos::BlockPos toSectionPos( int index )
+    {
+        return pos::BlockPos{
+            .x = compactBits( index >> 2 ),
+            .y = compactBits( index >> 1 ),
+            .z = compactBits( index ) };
+    }
+
+  private:
+    // Put 4 bits of the coordinate to every third bit: b3 b2 b1 b0 -> b3 0 0 b2 0 0 b1 0 0 b0
+    static constexpr int spreadBits( int coord )
+    {
+        return ( coord & 1 ) | ( ( coord & 2 ) << 2 ) | ( ( coord & 4 ) << 4 ) | ( ( coord & 8 ) << 6 );
+    }
+
+    // Inverse of spreadBits(), the bits between every third one are ignored
+    static constexpr int compactBits( int bits )
+    {
+        return ( bits & 1 ) | ( ( bits >> 2 ) & 2 ) | ( ( bits >> 4 ) & 4 ) | ( ( bits >> 6 ) & 8 );
+    }
+}; // struct MortonLayout
+
+#ifdef CHUNK_MORTON_LAYOUT
+using BlockLayout = MortonLayout;
+#else
+using BlockLayout = LinearLayout;
+#endif
+
+}; // namespace chunk
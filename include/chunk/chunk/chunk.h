@@ -1,63 +1,280 @@
 #pragma once
 
+#include "chunk/block_id.h"
+#include "chunk/block_layout.h"
+#include "chunk/palette_storage.h"
 #include "chunk/position.h"
 
 #include "utils/misc.h"
+#include <array>
 #include <cassert>
 #include <cstdint>
-#include <unordered_map>
+#include <memory>
+#include <span>
 
 namespace chunk
 {
 
-enum class BlockID : uint16_t
+/*
+ * Chunk is a column of k_sections_count vertical 16x16x16 sections. A section is either absent ( all air ),
+ * uniform ( filled with one block id ) or dense ( palette-packed ).
+ */
+class Chunk
 {
+  public:
+    static constexpr auto k_max_height = 256;
+    static constexpr auto k_max_width_length = 16;
+    static constexpr auto k_block_count = k_max_width_length * k_max_width_length * k_max_height;
 
-#define REGISTER_BLOCK( block_name, ... ) k_##block_name,
-#include "detail/block_id.inc"
-#undef REGISTER_BLOCK
-}; // enum class BlockID
+    static constexpr auto k_section_height = 16;
+    static constexpr auto k_sections_count = k_max_height / k_section_height;
+    static constexpr auto k_section_block_count = k_max_width_length * k_max_width_length * k_section_height;
+
+    // The largest plane of the chunk, it's orthogonal to X or Y
+    static constexpr auto k_max_slice_size = k_max_width_length * k_max_height;
+
+    static constexpr auto k_columns_count = k_max_width_length * k_max_width_length;
+
+    static_assert(
+        k_max_width_length == 16 && k_section_height == 16,
+        "Block layouts are defined for 16x16x16 sections" );
+
+    enum class SectionState
+    {
+        k_absent,
+        k_uniform,
+        k_dense
+    };
+
+    /*
+     * Range of sections [ begin, end ) between the lowest and the highest non-absent section.
+     * begin == end for the chunk containing only air.
+     */
+    struct SectionsRange
+    {
+        int begin;
+        int end;
+    };
+
+    /*
+     * Range of heights [ begin, end ) between the lowest and the highest non-air block.
+     * begin == end for the chunk containing only air.
+     */
+    struct HeightRange
+    {
+        int begin;
+        int end;
+    };
 
-class Chunk
-{
   public:
-    Chunk( BlockID* chunk_begin, pos::ChunkPos position )
-        : m_chunk_begin( chunk_begin ),
-          m_position{ position }
+    /*
+     * Blocks are stored bit-packed, so a non-const access returns this proxy
+     * instead of the real reference. Behaves like BlockID& for reading and assignment.
+     */
+    class BlockRef
     {
+      public:
+        BlockRef( Chunk& chunk, int index )
+            : m_chunk( chunk ),
+              m_index( index )
+        {
+        }
+
+        operator BlockID() const { return m_chunk[ m_index ]; }
+
+        BlockRef& operator=( BlockID block_id )
+        {
+            m_chunk.set( m_index, block_id );
+            return *this;
+        }
+
+        BlockRef& operator=( const BlockRef& other ) { return *this = static_cast<BlockID>( other ); }
+
+      private:
+        Chunk& m_chunk;
+        int m_index;
+    }; // class BlockRef
+
+  public:
+    explicit Chunk( pos::ChunkPos position, BlockID initial = BlockID::k_none )
+        : m_position{ position }
+    {
+        m_column_bottoms.fill( k_max_height );
+        fill( initial );
     }
 
     pos::ChunkPos getPosition() const { return m_position; }
+    void setPosition( pos::ChunkPos position ) { m_position = position; }
+
+    // Blocks were changed since the chunk was loaded or saved
+    bool isModified() const { return m_is_modified; }
+    void setModified( bool is_modified ) { m_is_modified = is_modified; }
 
-    const BlockID& operator[]( int index ) const&
+    BlockID operator[]( int index ) const
     {
         assert( index < k_block_count );
-        return m_chunk_begin[ index ];
+
+        const auto& section = m_sections[ index / k_section_block_count ];
+        return section ? section->get( index % k_section_block_count ) : BlockID::k_none;
     } // Chunk::operator[] const
 
-    const BlockID& at( uint8_t x, uint8_t y, uint8_t z ) const&
+    BlockID at( uint8_t x, uint8_t y, uint8_t z ) const&
     {
         assert( x < k_max_width_length && y < k_max_width_length );
-        return m_chunk_begin[ k_max_width_length * k_max_height * x + k_max_height * y + z ];
+        return ( *this )[ toIndex( x, y, z ) ];
     }
 
-    BlockID& at( uint8_t x, uint8_t y, uint8_t z ) &
+    BlockRef at( uint8_t x, uint8_t y, uint8_t z ) &
     {
         assert( x < k_max_width_length && y < k_max_width_length );
-        return m_chunk_begin[ k_max_width_length * k_max_height * x + k_max_height * y + z ];
+        return BlockRef{ *this, toIndex( x, y, z ) };
     }
 
-    BlockID& getChunkBegin() & { return m_chunk_begin[ 0 ]; }
+    void set( int index, BlockID block_id );
 
-  public:
-    static constexpr auto k_max_height = 256;
-    static constexpr auto k_max_width_length = 16;
-    static constexpr auto k_block_count = k_max_width_length * k_max_width_length * k_max_height;
+    SectionState getSectionState( int section ) const
+    {
+        assert( section < k_sections_count );
+
+        const auto& storage = m_sections[ section ];
+
+        if ( !storage )
+        {
+            return SectionState::k_absent;
+        }
+
+        return storage->isUniform() ? SectionState::k_uniform : SectionState::k_dense;
+    } // Chunk::getSectionState
+
+    SectionsRange getSectionsRange() const;
+
+    // Heights are kept up to date by every change of the blocks, so they are cheap to get
+    HeightRange getHeightRange() const { return m_height_range; }
+
+    // Height above the highest non-air block of the column, 0 for the column of air
+    int getColumnHeight( int x, int y ) const
+    {
+        assert( x >= 0 && x < k_max_width_length && y >= 0 && y < k_max_width_length );
+        return m_column_tops[ toColumnIndex( x, y ) ];
+    }
+
+    // Set all the blocks of the chunk to block_id
+    void fill( BlockID block_id );
+    void fillSection( int section, BlockID block_id );
+
+    // Unpack all the blocks to the plain array indexed with toIndex(). Used by the mesher
+    void decode( std::span<BlockID, k_block_count> blocks ) const;
+    void decodeSection( int section, std::span<BlockID, k_section_block_count> blocks ) const;
+
+    // Replace all the blocks with the plain array indexed with toIndex(). Sections of air become absent
+    void encode( std::span<const BlockID, k_block_count> blocks );
+    void encodeSection( int section, std::span<const BlockID, k_section_block_count> blocks );
+
+    // Unpack and pack the section in the linear layout whatever the layout of the chunk is. Used by the code working
+    // with the columns of blocks and by the serialization, so the saved chunks don't depend on the layout
+    void decodeSectionLinear( int section, std::span<BlockID, k_section_block_count> blocks ) const;
+    void encodeSectionLinear( int section, std::span<const BlockID, k_section_block_count> blocks );
+
+    // Drop block ides that are not used anymore from the palettes and release sections of air
+    void shrinkToFit();
+
+    std::size_t getAllocatedBytesCount() const;
+
+    /*
+     * Index in the plain array of blocks. Sections are stored one after another
+     * and blocks inside the section are ordered by the layout ( see block_layout.h ).
+     */
+    template <typename Layout = BlockLayout> static constexpr int toIndex( int x, int y, int z )
+    {
+        return ( z / k_section_height ) * k_section_block_count +
+            Layout::toSectionIndex( x, y, z % k_section_height );
+    }
+
+    /*
+     * Copy the plane of the unpacked chunk orthogonal to the axis ( 0 - X, 1 - Y, 2 - Z ) at the coordinate.
+     * The block ( u, v ) of the plane is at v * size( U ) + u, where U = { Y, Z, X } and V = { Z, X, Y }
+     * for the axes X, Y, Z. Only the blocks with z in [ z_begin, z_end ) are copied
+     */
+    template <typename Layout = BlockLayout>
+    static void extractSlice(
+        std::span<const BlockID, k_block_count> blocks,
+        int axis,
+        int coord,
+        int z_begin,
+        int z_end,
+        std::span<BlockID, k_max_slice_size> slice );
+
+    // Copy the plane of the chunk without unpacking it, like extractSlice() does for the unpacked blocks
+    void readSlice( int axis, int coord, int z_begin, int z_end, std::span<BlockID, k_max_slice_size> slice ) const;
+
+  private:
+    using SectionPtr = std::unique_ptr<PaletteStorage>;
+
+  private:
+    static constexpr int toColumnIndex( int x, int y ) { return x * k_max_width_length + y; }
+
+    // Update the heights of the column after its blocks in the section were changed. Non-air blocks
+    // of the column in the section are in [ begin, end ) relative to the section bottom, begin >= end for air
+    void updateColumn( int column, int section, int begin, int end );
+    void updateSectionColumns( int section, std::span<const BlockID, k_section_block_count> blocks );
+
+    // Find the highest and the lowest blocks of the column over all the sections
+    void scanColumn( int column );
+    void updateHeightRange();
 
   private:
-    // Pointer to the raw block ides in the array
-    BlockID* m_chunk_begin;
     pos::ChunkPos m_position;
+    std::array<SectionPtr, k_sections_count> m_sections;
+    bool m_is_modified = true;
+
+    // Heights of the columns indexed with toColumnIndex(). Top is the height above the highest non-air block
+    // and bottom is the height of the lowest one. Column of air has top = 0 and bottom = k_max_height
+    std::array<int16_t, k_columns_count> m_column_tops{};
+    std::array<int16_t, k_columns_count> m_column_bottoms{};
+    HeightRange m_height_range{};
 }; // class Chunk
 
+template <typename Layout>
+void
+Chunk::extractSlice(
+    std::span<const BlockID, k_block_count> blocks,
+    int axis,
+    int coord,
+    int z_begin,
+    int z_end,
+    std::span<BlockID, k_max_slice_size> slice )
+{
+    assert( axis >= 0 && axis < 3 );
+
+    switch ( axis )
+    {
+    case 0:
+        for ( int z = z_begin; z < z_end; z++ )
+        {
+            for ( int y = 0; y < k_max_width_length; y++ )
+            {
+                slice[ z * k_max_width_length + y ] = blocks[ toIndex<Layout>( coord, y, z ) ];
+            }
+        }
+        break;
+    case 1:
+        for ( int x = 0; x < k_max_width_length; x++ )
+        {
+            for ( int z = z_begin; z < z_end; z++ )
+            {
+                slice[ x * k_max_height + z ] = blocks[ toIndex<Layout>( x, coord, z ) ];
+            }
+        }
+        break;
+    default:
+        for ( int y = 0; y < k_max_width_length; y++ )
+        {
+            for ( int x = 0; x < k_max_width_length; x++ )
+            {
+                slice[ y * k_max_width_length + x ] = blocks[ toIndex<Layout>( x, y, coord ) ];
+            }
+        }
+    }
+} // Chunk::extractSlice
+
 }; // namespace chunk
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "chunk/chunk.h"
+#include "chunk/position.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace chunk
+{
+
+/*
+ * LRU cache of the chunks that left the region. Chunks are kept compressed ( see chunk_codec.h ),
+ * the least recently evicted ones are dropped when the cache doesn't fit into the budget.
+ */
+class ChunkCache
+{
+  public:
+    explicit ChunkCache( std::size_t budget_bytes );
+
+    // Put compressed blocks of the chunk at the position. The chunk is dropped if it's larger than the budget
+    void put( const pos::ChunkPos& position, std::vector<uint8_t> data, bool is_modified );
+
+    // Restore the chunk at its position and remove it from the cache. Return false if there is no such chunk
+    bool take( Chunk& chunk );
+
+    std::size_t getBudget() const { return m_budget_bytes; }
+    std::size_t getUsedBytes() const;
+
+    std::size_t getHitsCount() const;
+    std::size_t getMissesCount() const;
+
+  private:
+    struct Entry
+    {
+        pos::ChunkPos position;
+        std::vector<uint8_t> data;
+        bool is_modified; /* chunk wasn't saved to the disk */
+    };
+
+    using EntryList = std::list<Entry>;
+
+  private:
+    static std::size_t getEntryBytes( const Entry& entry ) { return sizeof( Entry ) + entry.data.capacity(); }
+
+    void erase( EntryList::iterator entry );
+
+  private:
+    const std::size_t m_budget_bytes;
+
+    // Chunks are evicted and loaded by several jobs at once
+    mutable std::mutex m_mutex;
+
+    // The most recent entry is at the front
+    EntryList m_entries;
+    std::unordered_map<pos::ChunkPos, EntryList::iterator> m_index;
+
+    std::size_t m_used_bytes = 0;
+    std::size_t m_hits_count = 0;
+    std::size_t m_misses_count = 0;
+}; // class ChunkCache
+
+}; // namespace chunk
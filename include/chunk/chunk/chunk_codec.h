@@ -0,0 +1,25 @@
+#pragma once
+
+#include "chunk/chunk.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace chunk
+{
+
+/*
+ * Compact byte representation of the chunk blocks used to keep chunks on the disk.
+ * Every section is stored as absent, uniform or a list of runs of equal block ides ( RLE ).
+ */
+
+// Serialize the blocks of the chunk, the position is not stored
+std::vector<uint8_t>
+compressChunk( const Chunk& chunk );
+
+// Restore the blocks of the chunk from compressChunk() data. Return false if the data is corrupted
+bool
+decompressChunk( std::span<const uint8_t> data, Chunk& chunk );
+
+}; // namespace chunk
@@ -2,8 +2,18 @@
 
 #include "chunk/chunk.h"
 
+#include <cstdint>
+
 namespace chunk
 {
+// Seed of the noise, should be set before the first chunk is generated. The seed is random if it's not set
+void
+setGenerationSeed( uint32_t seed );
+
+// The seed set by setGenerationSeed(). The random one is chosen by the first call, if the seed is not set
+uint32_t
+getGenerationSeed();
+
 void
 simpleChunkGen( Chunk& chunk_to_gen );
 }; // namespace chunk
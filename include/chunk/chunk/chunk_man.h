@@ -1,34 +1,36 @@
 #pragma once
 
 #include "chunk/chunk.h"
+#include "chunk/chunk_cache.h"
+#include "chunk/region_file.h"
 #include "utils/misc.h"
 
-#include <boost/functional/hash.hpp>
-
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
 #include <memory>
+#include <span>
+#include <vector>
 
-/**
- * Class containing hash function for std::unordered_map
- */
-namespace std
-{
-
-template <> struct hash<pos::ChunkPos>
+namespace chunk
 {
-    size_t operator()( const pos::ChunkPos& chunk_pos ) const
-    {
-        std::hash<decltype( chunk_pos.x )> hasher;
-        size_t seed = 0;
-        boost::hash_combine( seed, hasher( chunk_pos.x ) );
-        boost::hash_combine( seed, hasher( chunk_pos.y ) );
-        return seed;
-    }
-}; // struct ChunkHasher
 
-} // namespace std
-
-namespace chunk
+/*
+ * Lifecycle of the chunk in its slot. States change only forward in this order, except for the remeshing
+ * ( meshed or uploaded -> meshing ) and the eviction ( any idle state -> evicting -> empty )
+ */
+enum class ChunkState : uint8_t
 {
+    k_empty,      /* slot has no valid chunk */
+    k_generating, /* blocks are being generated */
+    k_generated,  /* blocks are ready, there is no mesh */
+    k_meshing,    /* mesh is being built */
+    k_meshed,     /* mesh is built, but not on the GPU yet */
+    k_uploaded,   /* mesh is ready to be drawn */
+    k_evicting    /* chunk is leaving the region */
+}; // enum class ChunkState
 
 /**
  * Class that contains all block ides and manage the chunks
@@ -38,15 +40,28 @@ class ChunkMan
 {
 
   public:
-    // Max chunks that can be viewed by the player
-    static constexpr auto k_render_distance = 10;
-    // the region is a square with the side equal to 2 * k_render_distance + 1
-    static constexpr auto k_chunks_count = ( 2 * k_render_distance + 1 ) * ( 2 * k_render_distance + 1 );
-    static constexpr auto k_blocks_count = k_chunks_count * Chunk::k_block_count;
+    // Max chunks that can be viewed by the player, used when nothing else is configured
+    static constexpr auto k_default_render_distance = 10;
+    // Render distance is limited by the bits of the local block coordinates in the mesher
+    static constexpr auto k_min_render_distance = 1;
+    static constexpr auto k_max_render_distance = 32;
+
+    // Memory for the compressed chunks that left the region
+    static constexpr std::size_t k_default_cache_budget_mb = 64;
 
   public:
-    using ChunkMap = std::unordered_map<pos::ChunkPos, Chunk>;
-    using BlockIDPtr = std::unique_ptr<std::array<BlockID, k_blocks_count>>;
+    /*
+     * Chunks are kept in a toroidal ring buffer: the chunk ( x, y ) lives in the slot ( x mod N, y mod N ),
+     * where N is the side of the region. The chunk leaving the region and the chunk entering it on the opposite
+     * side share the slot, so moving the origin never moves chunks around.
+     */
+    using ChunkRing = std::vector<Chunk>;
+
+    // Lifecycle states of the chunks, indexed by the slot as the chunks are
+    using StateRing = std::vector<std::atomic<ChunkState>>;
+
+    // Chunks changed since they were meshed, indexed by the slot as well
+    using DirtyRing = std::vector<std::atomic<bool>>;
 
   public:
     ChunkMan( const ChunkMan& ) = delete;
@@ -58,26 +73,222 @@ class ChunkMan
 
     static ChunkMan& getRef()
     {
-        static ChunkMan singleton_region{ { 0, 0 } };
+        static ChunkMan singleton_region{ { 0, 0 }, s_initial_render_distance };
         return singleton_region;
     } // ChunkMan::getRef
 
-    Chunk& getChunk( const pos::ChunkPos& pos );
+    // Set render distance of the singleton before it is created by the first getRef() call.
+    // Afterwards use setRenderDistance()
+    static void setInitialRenderDistance( int render_distance )
+    {
+        assert( render_distance >= k_min_render_distance && render_distance <= k_max_render_distance );
+        s_initial_render_distance = render_distance;
+    } // ChunkMan::setInitialRenderDistance
+
+    // Set the directory of the region files before the singleton is created. Chunks are loaded from it
+    // instead of the generation and saved to it, when they leave the region. Empty path disables saving
+    static void setWorldDirectory( std::filesystem::path world_directory )
+    {
+        s_world_directory = std::move( world_directory );
+    } // ChunkMan::setWorldDirectory
+
+    // Set the budget of the evicted chunks cache before the singleton is created
+    static void setCacheBudget( std::size_t budget_mb ) { s_cache_budget_mb = budget_mb; }
+
+    Chunk& getChunk( const pos::ChunkPos& pos )
+    {
+        assert( isInRegion( pos ) );
+
+        auto& chunk = m_chunks[ getSlotIndex( pos ) ];
+        assert( chunk.getPosition() == pos );
+
+        return chunk;
+    } // ChunkMan::getChunk
+
+    const Chunk& getChunk( const pos::ChunkPos& pos ) const
+    {
+        assert( isInRegion( pos ) );
+
+        const auto& chunk = m_chunks[ getSlotIndex( pos ) ];
+        assert( chunk.getPosition() == pos );
+
+        return chunk;
+    } // ChunkMan::getChunk const
+
+    bool isInRegion( const pos::ChunkPos& pos ) const
+    {
+        return std::abs( pos.x - m_origin_pos.x ) <= m_render_distance &&
+            std::abs( pos.y - m_origin_pos.y ) <= m_render_distance;
+    }
+
+    /*
+     * Lifecycle state queries and transitions don't take locks, so workers and the renderer can use them
+     * concurrently. The region itself ( origin and render distance ) is changed only when nobody else uses it.
+     */
+    ChunkState getChunkState( const pos::ChunkPos& pos ) const
+    {
+        return isInRegion( pos ) ? m_states[ getSlotIndex( pos ) ].load( std::memory_order_acquire )
+                                 : ChunkState::k_empty;
+    } // ChunkMan::getChunkState
+
+    // Atomically change the state from expected to desired. Return false if the state wasn't expected
+    bool tryChangeState( const pos::ChunkPos& pos, ChunkState expected, ChunkState desired )
+    {
+        assert( isInRegion( pos ) );
+        return m_states[ getSlotIndex( pos ) ].compare_exchange_strong( expected, desired, std::memory_order_acq_rel );
+    } // ChunkMan::tryChangeState
+
+    // Blocks of the chunk are generated and not changing
+    bool isGenerated( const pos::ChunkPos& pos ) const
+    {
+        const auto state = getChunkState( pos );
+        return state >= ChunkState::k_generated && state <= ChunkState::k_uploaded;
+    } // ChunkMan::isGenerated
+
+    // The chunk and its neighbours in the region are generated, so its faces can be found
+    bool isReadyForMeshing( const pos::ChunkPos& pos ) const;
+
+    // Chunks sharing the sides with the chunk in order -X, +X, -Y, +Y
+    static std::array<pos::ChunkPos, 4> getNeighbourPositions( const pos::ChunkPos& pos )
+    {
+        return std::array{
+            pos::ChunkPos{ pos.x - 1, pos.y },
+            pos::ChunkPos{ pos.x + 1, pos.y },
+            pos::ChunkPos{ pos.x, pos.y - 1 },
+            pos::ChunkPos{ pos.x, pos.y + 1 } };
+    } // ChunkMan::getNeighbourPositions
+
+    // The mesh of the chunk is on the GPU
+    bool isReadyForDrawing( const pos::ChunkPos& pos ) const
+    {
+        return getChunkState( pos ) == ChunkState::k_uploaded;
+    } // ChunkMan::isReadyForDrawing
+
+    /*
+     * Change the block of the world. The chunk containing it is marked dirty, and so is the neighbour,
+     * if the block is on their border. Return false if the chunk is not in the region or not generated,
+     * or the block is out of the height. The chunk shouldn't be meshed at the same time
+     */
+    bool setBlock( const pos::BlockPos& block_pos, BlockID block_id );
+
+    // Block of the world, k_none if the chunk is not in the region or not generated
+    BlockID getBlock( const pos::BlockPos& block_pos ) const;
+
+    // Chunk containing the block
+    static pos::ChunkPos toChunkPos( const pos::BlockPos& block_pos )
+    {
+        return pos::ChunkPos{ floorDiv( block_pos.x, Chunk::k_max_width_length ),
+                              floorDiv( block_pos.y, Chunk::k_max_width_length ) };
+    } // ChunkMan::toChunkPos
+
+    // The chunk was changed since it was meshed, so its mesh is out of date
+    bool isDirty( const pos::ChunkPos& pos ) const
+    {
+        return isInRegion( pos ) && m_dirty_flags[ getSlotIndex( pos ) ].load( std::memory_order_acquire );
+    } // ChunkMan::isDirty
+
+    void markDirty( const pos::ChunkPos& pos )
+    {
+        if ( isInRegion( pos ) )
+        {
+            m_dirty_flags[ getSlotIndex( pos ) ].store( true, std::memory_order_release );
+        }
+    } // ChunkMan::markDirty
+
+    // Called by the mesher before the chunk is meshed, so the edits made during the meshing are not lost
+    void clearDirty( const pos::ChunkPos& pos )
+    {
+        assert( isInRegion( pos ) );
+        m_dirty_flags[ getSlotIndex( pos ) ].store( false, std::memory_order_release );
+    } // ChunkMan::clearDirty
+
+    int getRenderDistance() const { return m_render_distance; }
+
+    // the region is a square with the side equal to 2 * render_distance + 1
+    int getSideLength() const { return m_side_length; }
+    int getChunksCount() const { return m_side_length * m_side_length; }
+
+    // Resize the region. Chunks that stay in the region are kept, only new ones are generated
+    void setRenderDistance( int render_distance );
+
     pos::ChunkPos& getOriginPos() { return m_origin_pos; }
     const pos::ChunkPos& getOriginPos() const { return m_origin_pos; }
 
-    // Change the region origin position ( the new_origin is the chunk, where the player is )
+    // Change the region origin position ( the new_origin is the chunk, where the player is ).
+    // The origin can be moved by any distance, only chunks that were not in the region are generated
     void changeOriginPos( const pos::ChunkPos& new_origin );
 
+    // Save the modified chunks of the region to the world directory ( if there is one )
+    void saveChunks();
+
+    // Memory used by the block storage of all the chunks
+    std::size_t getAllocatedBytesCount() const;
+
+    struct SectionsStats
+    {
+        std::size_t absent_count;
+        std::size_t uniform_count;
+        std::size_t dense_count;
+    };
+
+    // Count sections of the chunks by their state
+    SectionsStats getSectionsStats() const;
+
+    const ChunkCache& getCache() const { return m_cache; }
+
   private:
     /// [krisszzz] This constructor should be changed in the future
     /// because of chunk serialization ( working with file, etc.. )
-    ChunkMan( const pos::ChunkPos& origin_pos );
+    ChunkMan( const pos::ChunkPos& origin_pos, int render_distance );
+
+    // Division rounding towards negative infinity
+    static int floorDiv( int coord, int divisor ) { return ( coord >= 0 ? coord : coord - divisor + 1 ) / divisor; }
+
+    // Wrap the coordinate into [ 0, side_length ) ( mathematical modulo )
+    static int wrapCoord( int coord, int side_length ) { return ( coord % side_length + side_length ) % side_length; }
+
+    static std::size_t getSlotIndex( const pos::ChunkPos& pos, int side_length )
+    {
+        return static_cast<std::size_t>( wrapCoord( pos.x, side_length ) * side_length +
+                                         wrapCoord( pos.y, side_length ) );
+    }
+
+    std::size_t getSlotIndex( const pos::ChunkPos& pos ) const { return getSlotIndex( pos, m_side_length ); }
+
+    // Generate chunks at the positions in their slots. Positions should be in the region
+    void generateChunks( std::span<const pos::ChunkPos> positions );
+
+    // Load the chunk from the disk or generate it, if it's not saved
+    void loadOrGenerateChunk( Chunk& chunk );
+
+    // Remove the chunks that left the region from their slots. Modified chunks are saved
+    void evictChunks( std::span<const std::size_t> slots );
+
+    // Change the state, that is known to be expected ( the caller owns the slot )
+    void changeState( std::size_t slot, ChunkState expected, ChunkState desired )
+    {
+        [[maybe_unused]] auto is_changed =
+            m_states[ slot ].compare_exchange_strong( expected, desired, std::memory_order_acq_rel );
+        assert( is_changed && "Unexpected chunk state" );
+    } // ChunkMan::changeState
+
+  private:
+    static inline int s_initial_render_distance = k_default_render_distance;
+    static inline std::filesystem::path s_world_directory = {};
+    static inline std::size_t s_cache_budget_mb = k_default_cache_budget_mb;
 
   private:
     pos::ChunkPos m_origin_pos;
-    ChunkMap m_chunks;
-    BlockIDPtr m_block_ides;
+    int m_render_distance;
+    int m_side_length;
+    ChunkRing m_chunks;
+    StateRing m_states;
+    DirtyRing m_dirty_flags;
+
+    ChunkCache m_cache;
+
+    // nullptr if the world is not saved
+    std::unique_ptr<RegionStorage> m_storage;
 }; // class ChunkMan
 
 }; // namespace chunk
@@ -1,13 +1,19 @@
+#pragma once
+
 #include "chunk/chunk.h"
 #include "chunk/chunk_man.h"
 #include "common/vulkan_include.h"
+#include <array>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <span>
+#include <vector>
 
 namespace chunk
 {
 
-/* class that convert block id and position to an array of vertices */
+/* class that convert block id and position of the chunk to an array of vertices */
 class ChunkMesher
 {
     /* These structures are part of realisition of ChunkMesher.
@@ -51,12 +57,11 @@ class ChunkMesher
         "TextureCoords should be 4 byte for correct work" );
 
     /*
-     * Class that used to indexing by local coordinates in array of blocks
-     * that should be rendered. Render area is a square with the side
-     * equal to 2 * k_render_distance + 1 chunks.
+     * Coordinates of the vertex relative to the chunk. Meshes don't depend on the place of the chunk
+     * in the region, the vertex shader adds the position of the chunk
      */
 
-    struct __attribute__( ( packed ) ) RenderAreaBlockPos
+    struct __attribute__( ( packed ) ) LocalBlockPos
     {
       private:
         constexpr static auto max_x_bits = 11;
@@ -68,43 +73,84 @@ class ChunkMesher
         constexpr static auto k_max_y = ( 1 << max_y_bits ) - 1;
         constexpr static auto k_max_z = ( 1 << max_z_bits ) - 1;
 
-        constexpr RenderAreaBlockPos( uint16_t local_x, uint16_t local_y, uint16_t local_z )
+        constexpr LocalBlockPos( uint16_t local_x, uint16_t local_y, uint16_t local_z )
             : x( local_x ),
               y( local_y ),
               z( local_z ){};
 
-        // coordinate system starting right corner of
-        // render area
+        // coordinate system starting at the lowest corner of the chunk
         uint16_t x : max_x_bits;
         uint16_t y : max_y_bits;
         uint16_t z : max_z_bits;
 
         static_assert(
-            k_max_x >= Chunk::k_max_width_length * ( 2 * ChunkMan::k_render_distance + 1 ),
-            "Cannot use local coordinates because render distance is too large" );
+            k_max_x >= Chunk::k_max_width_length && k_max_y >= Chunk::k_max_width_length &&
+                k_max_z >= Chunk::k_max_height,
+            "Cannot represent all the vertices of the chunk" );
     };
 
-    static_assert(
-        sizeof( RenderAreaBlockPos ) == sizeof( uint32_t ),
-        "RenderAreaBlockPos should be 4 byte for correct work" );
+    static_assert( sizeof( LocalBlockPos ) == sizeof( uint32_t ), "LocalBlockPos should be 4 byte for correct work" );
 
     /*
      * struct of vertex that will be sent to vertex shader
      */
     struct __attribute__( ( packed ) ) Vertex
     {
-        constexpr Vertex( RenderAreaBlockPos position_par, BlockID block_id, uint16_t width, uint16_t height )
+        constexpr Vertex( LocalBlockPos position_par, BlockID block_id, uint16_t width, uint16_t height )
             : position( position_par ),
               tex_descr( block_id, width, height )
         {
         }
 
-        RenderAreaBlockPos position;
+        LocalBlockPos position;
         VertexTextureDescr tex_descr;
     };
 
     static_assert( sizeof( Vertex ) == sizeof( uint64_t ), "Vertex should be 8 byte for correct work" );
 
+    /*
+     * Position of the lowest corner of the face relative to the chunk and the direction of the face. The face lies
+     * in the plane orthogonal to the axis dim ( 0 - X, 1 - Y, 2 - Z ), see ChunkMesher::addQuad()
+     */
+    struct __attribute__( ( packed ) ) QuadPos
+    {
+        constexpr QuadPos( uint32_t local_x, uint32_t local_y, uint32_t local_z, uint32_t dim_par, bool is_front )
+            : x( local_x ),
+              y( local_y ),
+              z( local_z ),
+              dim( dim_par ),
+              is_front_face( is_front )
+        {
+        }
+
+        uint32_t x : 5;
+        uint32_t y : 5;
+        uint32_t z : 9;
+        uint32_t dim : 2;
+        uint32_t is_front_face : 1;
+        uint32_t : 10;
+    };
+
+    static_assert( sizeof( QuadPos ) == sizeof( uint32_t ), "QuadPos should be 4 byte for correct work" );
+
+    /*
+     * Whole face in one record, the vertex shader makes its 6 vertices from gl_VertexIndex. Width and height
+     * of the face are stored as the texture coordinates of its farthest vertex
+     */
+    struct __attribute__( ( packed ) ) Quad
+    {
+        constexpr Quad( QuadPos position_par, BlockID block_id, uint16_t width, uint16_t height )
+            : position( position_par ),
+              tex_descr( block_id, width, height )
+        {
+        }
+
+        QuadPos position;
+        VertexTextureDescr tex_descr;
+    };
+
+    static_assert( sizeof( Quad ) == sizeof( Vertex ), "Quad should be 8 byte for correct work" );
+
     /*
      * Specify information needed for vulkan about vertex format
      */
@@ -123,76 +169,254 @@ class ChunkMesher
         int width;          /* width of the face */
         int height;         /* height of the face */
 
-        RenderAreaBlockPos v1; /* first vertex of the face */
-        RenderAreaBlockPos v2; /* second vertex of the face */
-        RenderAreaBlockPos v3; /* third vertex of the face */
-        RenderAreaBlockPos v4; /* fourth vertex of the face */
+        LocalBlockPos v1; /* first vertex of the face */
+        LocalBlockPos v2; /* second vertex of the face */
+        LocalBlockPos v3; /* third vertex of the face */
+        LocalBlockPos v4; /* fourth vertex of the face */
+    };
+
+  public:
+    /*
+     * Faces of the mesh are grouped by the directions of their normals in order -X, +X, -Y, +Y, -Z, +Z.
+     * The front face orthogonal to the axis dim is of the direction 2 * dim + 1, the back one is of 2 * dim
+     */
+    static constexpr std::size_t k_directions_count = 6;
+
+    // Faces of one direction: the range of the indices or of the quads of the mesh
+    struct FaceRange
+    {
+        uint32_t first;
+        uint32_t count;
+    };
+
+  private:
+    /* faces of the chunk being meshed, indices and quads are kept by the directions */
+    struct Faces
+    {
+        std::vector<Vertex> vertices;
+        std::array<std::vector<uint32_t>, k_directions_count> indices;
+        std::array<std::vector<Quad>, k_directions_count> quads;
+
+        void clear()
+        {
+            vertices.clear();
+
+            for ( std::size_t direction = 0; direction < k_directions_count; direction++ )
+            {
+                indices[ direction ].clear();
+                quads[ direction ].clear();
+            }
+        }
+    };
+
+  public:
+    /*
+     * Planes of the neighbours touching the sides of the chunk in the layout of Chunk::extractSlice().
+     * Sides are in order -X, +X, -Y, +Y. The face between two chunks is made by the chunk with the non-air
+     * block, so the face between two non-air blocks is not made at all
+     */
+    using NeighbourSides = std::array<std::array<BlockID, Chunk::k_max_slice_size>, 4>;
+
+    /*
+     * Box of the blocks covered by the mesh in the world coordinates, max is not included
+     */
+    struct Bounds
+    {
+        pos::BlockPos min;
+        pos::BlockPos max;
+
+        // Faces of the direction inside the bounds can be seen from the point ( in the world coordinates ) only if
+        // it is in front of the lowest ( or the highest ) plane of the bounds. Otherwise all of them are turned away
+        bool isFacing( std::size_t direction, float x, float y, float z ) const;
     };
 
+    /*
+     * Mesh of one chunk. Vertices are relative to the chunk and indices are relative to the first vertex
+     * of the mesh, so the mesh is the same wherever the region is. Only one of vertices with indices and quads
+     * is filled, depending on the format of the meshes ( see MeshFormat ). Indices are 16 bits wide, the wide ones
+     * are used instead only by the meshes with more vertices than 16 bits can address
+     */
+    struct ChunkMesh
+    {
+        pos::ChunkPos position;
+        std::vector<Vertex> vertices;
+        std::vector<uint16_t> indices;
+        std::vector<uint32_t> wide_indices;
+        std::vector<Quad> quads;
+        Bounds bounds;
+
+        // Sides ( -X, +X, -Y, +Y ) facing the neighbours that were not generated, they are closed with the faces.
+        // The mesh is outdated when the neighbour is generated or leaves the region
+        std::array<bool, 4> is_side_closed;
+
+        // Faces of every direction are stored one after another
+        std::array<FaceRange, k_directions_count> face_ranges;
+
+        bool isEmpty() const { return indices.empty() && wide_indices.empty() && quads.empty(); }
+
+        std::size_t getIndicesCount() const { return indices.size() + wide_indices.size(); }
+
+        uint32_t getIndex( std::size_t index ) const
+        {
+            return wide_indices.empty() ? indices[ index ] : wide_indices[ index ];
+        }
+
+        vk::IndexType getIndexType() const { return wide_indices.empty() ? k_index_type : k_wide_index_type; }
+    };
+
+    /*
+     * Scratch buffers of the meshing: the unpacked blocks, the planes, the bitmasks and the faces being made.
+     * Meshing keeps no other state, so chunks can be meshed at once by the threads owning their own contexts.
+     * The buffers are big, so the context is allocated once and reused for many chunks
+     */
+    class MesherContext
+    {
+      public:
+        MesherContext();
+        MesherContext( MesherContext&& ) noexcept;
+        MesherContext& operator=( MesherContext&& ) noexcept;
+        ~MesherContext();
+
+      private:
+        friend class ChunkMesher;
+
+        struct Scratch; /* defined by the mesher */
+        std::unique_ptr<Scratch> m_scratch;
+    }; // class MesherContext
+
   private:
     /*
-     * add face of block. The face_info is const auto&, because you cannot define
+     * add face of block to the faces of the direction. The face_info is const auto&, because you cannot define
      * this function from the outside, if you pick const FaceInfo& ( because it's private )
      */
-    void addFace( const auto& face_info );
+    static void addFace( Faces& faces, std::size_t direction, const auto& face_info );
 
     /*
-     * Convert 3 coordinates of type uint16_t to local coordinates and return RenderAreaBlockPos.
-     * Here is auto as return value because RenderAreaBlockPos is private structure
+     * Convert 3 coordinates of type uint16_t to local coordinates and return LocalBlockPos.
+     * Here is auto as return value because LocalBlockPos is private structure
      */
 
-    auto toRenderAreaBlockPos( uint16_t x, uint16_t y, uint16_t z, const pos::ChunkPos& chunk_pos ) const;
+    static auto toLocalBlockPos( uint16_t x, uint16_t y, uint16_t z );
 
-  public:
     /*
-     * Index type in index buffer
+     * Add the face of width x height blocks lying in the plane orthogonal to the axis axes.dim
+     * ( 0 - X, 1 - Y, 2 - Z ). The corner is the lowest block of the face in the coordinates of the chunk.
+     * Width is along the axis U = { Y, Z, X } and height is along the axis V = { Z, X, Y } for the axes X, Y, Z.
+     * Axes are known at compile time or at run time ( see greedySweep() )
      */
-    constexpr static vk::IndexType k_index_type = vk::IndexType::eUint32;
+    static void addQuad(
+        Faces& faces,
+        auto axes,
+        const std::array<int, 3>& corner,
+        int width,
+        int height,
+        bool is_front_face,
+        BlockID block_id );
+
+    // Unpack the sections of the chunk with the blocks between the lowest and the highest non-air ones.
+    // Blocks out of the range of heights are not written
+    static void decodeOccupiedSections( const Chunk& chunk, std::span<BlockID, Chunk::k_block_count> blocks );
+
+    // Unpack the chunk and sweep it along the axes, the axes of every sweep are given by its own argument
+    static void greedyMeshAxes(
+        const Chunk& chunk,
+        const NeighbourSides& neighbour_sides,
+        MesherContext& context,
+        auto... sweep_axes );
+
+    // Merge the faces of the planes orthogonal to axes.dim. Planes between two blocks of the same flat section
+    // ( absent or uniform ) are skipped
+    static void greedySweep(
+        const Chunk& chunk,
+        const NeighbourSides& neighbour_sides,
+        MesherContext& context,
+        const std::array<bool, Chunk::k_sections_count>& is_flat_section,
+        auto axes );
 
   public:
     /*
-     * Mesh the area that player can see
+     * Index types in index buffer. Every mesh is drawn from its own vertex buffer, so 16 bits are enough
+     * for almost every chunk. The rest take the wide indices ( see ChunkMesh::getIndexType )
      */
-    void meshRenderArea();
+    constexpr static vk::IndexType k_index_type = vk::IndexType::eUint16;
+    constexpr static vk::IndexType k_wide_index_type = vk::IndexType::eUint32;
+
+    // There is no primitive restart, so every value of the 16-bit index is a vertex
+    constexpr static std::size_t k_max_short_indexed_vertices = std::size_t{ 1 } << 16;
 
     /*
-     * Algorithm for meshing one chunk
+     * Algorithm used for meshing the chunks. All of them make the same faces in the same order
      */
-    void greedyMesh( const pos::ChunkPos& chunk_pos, const Chunk& chunk );
+    enum class MeshingMode
+    {
+        k_greedy,            /* greedyMesh() */
+        k_greedy_fixed_axes, /* greedyMeshFixedAxes() */
+        k_binary             /* binaryMesh() */
+    };
+
+    // Should be chosen before anything is meshed
+    static void setMeshingMode( MeshingMode mode ) { s_meshing_mode = mode; }
+    static MeshingMode getMeshingMode() { return s_meshing_mode; }
 
     /*
-     * Get description of the vertex format that used for meshing
+     * Format of the meshes. Quads take 8 bytes per face instead of 4 vertices and 6 indices ( 56 bytes ),
+     * they are drawn without the index buffer, 6 vertices per instance ( see getVertexInfo() )
      */
+    enum class MeshFormat
+    {
+        k_vertices, /* ChunkMesh::vertices and ChunkMesh::indices */
+        k_quads     /* ChunkMesh::quads */
+    };
 
-    static VertexInfo getVertexInfo();
+    // Should be chosen before anything is meshed and before the pipeline is made
+    static void setMeshFormat( MeshFormat format ) { s_mesh_format = format; }
+    static MeshFormat getMeshFormat() { return s_mesh_format; }
 
-    uint32_t getVerticesCount() const { return m_vertices.size(); }
+    // Number of the vertices the vertex shader makes from one quad
+    static constexpr uint32_t k_quad_vertices_count = 6;
 
-    const Vertex* getVerticesData() const { return m_vertices.data(); };
+  public:
+    /*
+     * Mesh the chunk of the region. The chunk and its neighbours in the region should be generated
+     * ( see ChunkMan::isReadyForMeshing() ), neighbours that are not generated are treated as air.
+     * The context shouldn't be used by another thread meanwhile
+     */
+    static ChunkMesh meshChunk( const pos::ChunkPos& chunk_pos, MesherContext& context );
 
-    uint32_t getVertexBufferSize() const { return m_vertices.size() * sizeof( Vertex ); }
+    // Copy the blocks of the neighbours with z in [ z_begin, z_end ). Neighbours out of the region are air,
+    // so the sides of the region are closed
+    static void readNeighbourSides( const pos::ChunkPos& chunk_pos, int z_begin, int z_end, NeighbourSides& sides );
 
-    uint32_t getIndicesCount() const { return m_indices.size(); }
+    /*
+     * Algorithm for meshing one chunk. Faces depend only on the chunk and the planes of its neighbours
+     * ( see readNeighbourSides() ), they replace the faces of the context
+     */
+    static void greedyMesh( const Chunk& chunk, const NeighbourSides& neighbour_sides, MesherContext& context );
 
-    const uint32_t* getIndicesData() const { return m_indices.data(); };
+    /*
+     * greedyMesh() with the sweeps compiled for every axis. The masks of the faces are built by the same kernels
+     * and the merging of the faces is not vectorized either way, so it is not measurably faster than greedyMesh().
+     * Used to measure what the specialization gives
+     */
+    static void greedyMeshFixedAxes(
+        const Chunk& chunk,
+        const NeighbourSides& neighbour_sides,
+        MesherContext& context );
 
-    uint32_t getIndexBufferSize() const { return m_indices.size() * sizeof( uint32_t ); }
+    /*
+     * Greedy meshing on the bitmasks of non-air blocks. Faces of a whole row of blocks are found
+     * with a few bitwise operations and merged by runs of set bits instead of block by block
+     */
+    static void binaryMesh( const Chunk& chunk, const NeighbourSides& neighbour_sides, MesherContext& context );
 
     /*
-     * [krisszzz]: This function should be private and used only for
-     * updating uniform buffer. I will do it soon
+     * Get description of the vertex format that used for meshing. Quads are read once per instance
      */
-    pos::ChunkPos getRenderAreaRight() const { return m_render_area_right; }
 
-    uint32_t getAllocatedBytesCount() const
-    {
-        return m_vertices.capacity() * sizeof( Vertex ) + m_indices.capacity() * sizeof( uint32_t );
-    }
+    static VertexInfo getVertexInfo();
 
   private:
-    /* right corner of render area */
-    pos::ChunkPos m_render_area_right;
-    std::vector<Vertex> m_vertices;
-    std::vector<uint32_t> m_indices;
+    static inline MeshingMode s_meshing_mode = MeshingMode::k_binary;
+    static inline MeshFormat s_mesh_format = MeshFormat::k_vertices;
 }; // class ChunkMesher
 }; // namespace chunk
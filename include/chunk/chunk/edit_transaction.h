@@ -0,0 +1,166 @@
+#pragma once
+
+#include "chunk/block_id.h"
+#include "chunk/chunk.h"
+#include "chunk/position.h"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace chunk
+{
+
+/*
+ * Box of blocks copied from the world. Blocks are ordered as x, y, z ( z is the fastest ) like in the sections
+ * unpacked in the linear layout, so a column of the region is copied to the section with one std::copy
+ */
+class BlockRegion
+{
+  public:
+    BlockRegion( int size_x, int size_y, int size_z, BlockID initial = BlockID::k_none )
+        : m_size_x( size_x ),
+          m_size_y( size_y ),
+          m_size_z( size_z ),
+          m_blocks( static_cast<std::size_t>( size_x ) * size_y * size_z, initial )
+    {
+        assert( size_x > 0 && size_y > 0 && size_z > 0 );
+    }
+
+    int getSizeX() const { return m_size_x; }
+    int getSizeY() const { return m_size_y; }
+    int getSizeZ() const { return m_size_z; }
+
+    BlockID at( int x, int y, int z ) const { return m_blocks[ toIndex( x, y, z ) ]; }
+    BlockID& at( int x, int y, int z ) { return m_blocks[ toIndex( x, y, z ) ]; }
+
+    std::span<const BlockID> getColumn( int x, int y ) const
+    {
+        return std::span{ m_blocks }.subspan( toIndex( x, y, 0 ), m_size_z );
+    }
+
+    std::span<BlockID> getColumn( int x, int y )
+    {
+        return std::span{ m_blocks }.subspan( toIndex( x, y, 0 ), m_size_z );
+    }
+
+  private:
+    std::size_t toIndex( int x, int y, int z ) const
+    {
+        assert( x >= 0 && x < m_size_x && y >= 0 && y < m_size_y && z >= 0 && z < m_size_z );
+        return ( static_cast<std::size_t>( x ) * m_size_y + y ) * m_size_z + z;
+    }
+
+  private:
+    int m_size_x;
+    int m_size_y;
+    int m_size_z;
+    std::vector<BlockID> m_blocks;
+}; // class BlockRegion
+
+/*
+ * Batch of edits of the world, applied by commit(). Every section touched by the edits is unpacked and packed
+ * back only once, the edits write whole columns of the unpacked section. Sections covered by a box are filled
+ * without unpacking, if they are not dense. Only the blocks that really change count: changed chunks ( and
+ * the neighbours sharing the changed borders ) are marked dirty once per transaction, so they are remeshed once.
+ * Sections without changed blocks are left as they are.
+ *
+ * Boxes are given by two opposite corners, both included. Blocks out of the region or the height are ignored.
+ * Like ChunkMan::setBlock(), the transaction shouldn't be committed while the chunks are meshed
+ */
+class EditTransaction
+{
+  public:
+    // Set all the blocks of the box
+    void fillBox( const pos::BlockPos& first, const pos::BlockPos& last, BlockID block_id );
+
+    // Change the blocks with the replaced id of the box
+    void replace( const pos::BlockPos& first, const pos::BlockPos& last, BlockID replaced_id, BlockID block_id );
+
+    // Set the blocks that are not farther than the radius from the center
+    void fillSphere( const pos::BlockPos& center, int radius, BlockID block_id );
+
+    // Put the region with its lowest corner at the origin. Air of the region is skipped, if is_air_skipped.
+    // The region isn't copied, it should live until the commit
+    void paste( const BlockRegion& region, const pos::BlockPos& origin, bool is_air_skipped = false );
+
+    // Copy the box of the world as it is now, the edits that are not committed are not seen
+    static BlockRegion copy( const pos::BlockPos& first, const pos::BlockPos& last );
+
+    // Apply the edits in the order they were made. Return the number of changed chunks
+    std::size_t commit();
+
+    bool isEmpty() const { return m_operations.empty(); }
+
+  private:
+    enum class OperationKind
+    {
+        k_fill,
+        k_replace,
+        k_sphere,
+        k_paste
+    };
+
+    // Box [ min, end ) of the world blocks
+    struct Box
+    {
+        pos::BlockPos min;
+        pos::BlockPos end;
+
+        bool isEmpty() const { return min.x >= end.x || min.y >= end.y || min.z >= end.z; }
+        friend bool operator==( const Box& lhs, const Box& rhs ) = default;
+    };
+
+    struct Operation
+    {
+        OperationKind kind;
+        Box box; /* blocks that can be changed */
+        BlockID block_id;
+        BlockID replaced_id;       /* k_replace */
+        pos::BlockPos center;      /* k_sphere */
+        int radius;                /* k_sphere */
+        const BlockRegion* region; /* k_paste, placed at box.min */
+        bool is_air_skipped;       /* k_paste */
+    };
+
+    // What the transaction did to the chunk
+    struct ChunkChanges
+    {
+        bool is_changed;
+        std::array<bool, 4> is_border_changed; /* -x, +x, -y, +y */
+
+        void merge( const ChunkChanges& other )
+        {
+            is_changed |= other.is_changed;
+
+            for ( std::size_t border = 0; border < is_border_changed.size(); border++ )
+            {
+                is_border_changed[ border ] |= other.is_border_changed[ border ];
+            }
+        }
+    };
+
+    using SectionBlocks = std::array<BlockID, Chunk::k_section_block_count>;
+
+  private:
+    static Box makeBox( const pos::BlockPos& first, const pos::BlockPos& last );
+    static Box intersect( const Box& lhs, const Box& rhs );
+    static Box getSectionBox( const pos::ChunkPos& chunk_pos, int section );
+
+    ChunkChanges applyToChunk( Chunk& chunk ) const;
+
+    // Apply the operation to the part of the unpacked section. The section starts at section_min.
+    // Return the changes made by the blocks that got another id
+    static ChunkChanges applyToSection(
+        const Operation& operation,
+        const Box& part,
+        const pos::BlockPos& section_min,
+        SectionBlocks& blocks );
+
+  private:
+    std::vector<Operation> m_operations;
+}; // class EditTransaction
+
+}; // namespace chunk
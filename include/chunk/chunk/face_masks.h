@@ -0,0 +1,57 @@
+#pragma once
+
+#include "chunk/block_id.h"
+
+#include <cstdint>
+#include <span>
+
+namespace chunk
+{
+
+/*
+ * Masks of the faces between two planes of blocks used by the greedy mesher. For every pair of blocks
+ * current[ i ] and next[ i ] there is a face, if one of them is air:
+ *  - cmp[ i ] is set, if the face is made by the chunk ( see ChunkMesher::NeighbourSides ),
+ *  - normal[ i ] is set, if the face is the front one ( next block is air ),
+ *  - face[ i ] is the non-air block of the two.
+ * The current plane is of the lower neighbour, if is_lower_side is set, and the next one is of the upper
+ * neighbour, if is_upper_side is set. Masks are built 16 or 8 blocks at a time, if the CPU can do it
+ */
+
+// Instruction sets the masks can be built with
+enum class FaceMasksIsa
+{
+    k_scalar,
+    k_sse41,
+    k_avx2
+};
+
+struct FaceMasks
+{
+    std::span<bool> cmp;
+    std::span<bool> normal;
+    std::span<BlockID> face;
+};
+
+// The widest instruction set supported by the CPU
+FaceMasksIsa
+getSupportedFaceMasksIsa();
+
+// Instruction set used by buildFaceMasks(), the widest supported one by default. Should be chosen before
+// anything is meshed and should be supported by the CPU
+void
+setFaceMasksIsa( FaceMasksIsa isa );
+
+FaceMasksIsa
+getFaceMasksIsa();
+
+// Build the masks of the blocks of the planes, all the spans should be of the same size
+void
+buildFaceMasks(
+    std::span<const BlockID> current,
+    std::span<const BlockID> next,
+    bool is_lower_side,
+    bool is_upper_side,
+    const FaceMasks& masks );
+
+}; // namespace chunk
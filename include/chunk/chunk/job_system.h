@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace chunk
+{
+
+enum class JobPriority
+{
+    k_high,
+    k_normal,
+    k_low,
+
+    /* end limiter */
+    k_max
+}; // enum class JobPriority
+
+/**
+ * Work-stealing thread pool. Every worker owns a deque of jobs per priority: the owner pushes and pops
+ * jobs from the back, idle workers steal from the front of the other deques. Jobs of higher priority
+ * are always taken first, even if they have to be stolen.
+ */
+
+class JobSystem
+{
+  public:
+    using Job = std::function<void()>;
+
+  public:
+    explicit JobSystem( unsigned workers_count = std::thread::hardware_concurrency() );
+
+    JobSystem( const JobSystem& ) = delete;
+    JobSystem( JobSystem&& ) = delete;
+
+    JobSystem& operator=( const JobSystem& ) = delete;
+    JobSystem& operator=( JobSystem&& ) = delete;
+    ~JobSystem();
+
+    static JobSystem& getRef()
+    {
+        static JobSystem singleton_job_system{};
+        return singleton_job_system;
+    } // JobSystem::getRef
+
+    unsigned getWorkersCount() const { return static_cast<unsigned>( m_workers.size() ); }
+
+    // Index of the worker the caller runs on or getWorkersCount() for the threads outside of the pool
+    unsigned getCurrentWorkerIndex() const;
+
+    void submit( Job job, JobPriority priority = JobPriority::k_normal );
+
+    // Submit a job returning a value, the result is obtained through std::future
+    template <typename Func> auto submitTask( Func&& func, JobPriority priority = JobPriority::k_normal )
+    {
+        using Result = std::invoke_result_t<Func>;
+
+        // std::function should be copyable, so the task is shared
+        auto task = std::make_shared<std::packaged_task<Result()>>( std::forward<Func>( func ) );
+        auto future = task->get_future();
+
+        submit( [ task ]() { ( *task )(); }, priority );
+        return future;
+    } // JobSystem::submitTask
+
+    // Run func( index ) for every index in [ 0, count ) on the pool and wait for all of them.
+    // The calling thread helps to execute the jobs, so it's allowed to call it from a job
+    void parallelFor(
+        std::size_t count,
+        const std::function<void( std::size_t )>& func,
+        JobPriority priority = JobPriority::k_normal );
+
+    // Execute one pending job on the calling thread. Return false if there were no jobs
+    bool tryRunPendingJob();
+
+  private:
+    static constexpr auto k_priorities_count = static_cast<std::size_t>( JobPriority::k_max );
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::array<std::deque<Job>, k_priorities_count> jobs;
+    }; // struct Worker
+
+  private:
+    void workerLoop( unsigned worker_index );
+
+    bool popOwnJob( unsigned worker_index, std::size_t priority, Job& job );
+    bool stealJob( unsigned thief_index, std::size_t priority, Job& job );
+    bool takeJob( unsigned worker_index, Job& job );
+
+  private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::jthread> m_threads;
+
+    std::atomic<std::size_t> m_pending_count = 0;
+    std::atomic<unsigned> m_next_worker = 0;
+
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_sleep_cv;
+    bool m_stop = false;
+}; // class JobSystem
+
+}; // namespace chunk
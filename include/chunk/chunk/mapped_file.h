@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace chunk
+{
+
+/*
+ * Read-only memory mapping of the whole file ( POSIX mmap ). The data is read straight from the page cache,
+ * without copying it to the user buffers. The mapping doesn't grow with the file, it should be recreated.
+ * The mapping of the empty file has no data.
+ */
+class MappedFile
+{
+  public:
+    explicit MappedFile( const std::filesystem::path& path );
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile( MappedFile&& other ) noexcept;
+
+    MappedFile& operator=( const MappedFile& ) = delete;
+    MappedFile& operator=( MappedFile&& other ) noexcept;
+    ~MappedFile();
+
+    std::span<const uint8_t> getData() const { return { m_data, m_size }; }
+    std::size_t getSize() const { return m_size; }
+
+    // Hint the kernel that the range is going to be read soon, so it's read ahead asynchronously
+    void prefetch( std::size_t offset, std::size_t size ) const;
+
+  private:
+    void unmap();
+
+  private:
+    const uint8_t* m_data = nullptr;
+    std::size_t m_size = 0;
+}; // class MappedFile
+
+}; // namespace chunk
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "chunk/chunk_mesher.h"
+#include "chunk/position.h"
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace chunk
+{
+
+/*
+ * Meshes of the chunks of the region, one for every chunk. Meshes don't depend on the origin of the region,
+ * so when the region is moved or the blocks are edited only the new and the changed chunks are meshed
+ */
+class MeshRegistry
+{
+  public:
+    using ChunkMesh = ChunkMesher::ChunkMesh;
+
+    /*
+     * Meshes replacing the meshes of the same chunks ( or new for the registry ) and the chunks that left
+     * the region, whose meshes are removed
+     */
+    struct MeshUpdate
+    {
+        std::vector<ChunkMesh> meshes;
+        std::vector<pos::ChunkPos> removed;
+
+        bool isEmpty() const { return meshes.empty() && removed.empty(); }
+    };
+
+  public:
+    /*
+     * Mesh the chunks of the region that have no mesh, are dirty ( see ChunkMan::setBlock() ) or whose neighbours
+     * were generated or left the region since they were meshed. Chunks are meshed in parallel. The meshes of
+     * the registry are not changed, so they can be drawn meanwhile, but only one update is collected at once
+     */
+    MeshUpdate collectUpdate() const;
+
+    void applyUpdate( MeshUpdate update );
+
+    /*
+     * Mark the meshed chunks of the region as uploaded, when their meshes are copied to the GPU
+     */
+    void markUploaded() const;
+
+    const ChunkMesh* findMesh( const pos::ChunkPos& position ) const
+    {
+        auto found = m_meshes.find( position );
+        return found != m_meshes.end() ? &found->second : nullptr;
+    }
+
+    const std::unordered_map<pos::ChunkPos, ChunkMesh>& getMeshes() const { return m_meshes; }
+
+    std::size_t getVerticesCount() const;
+    std::size_t getIndicesCount() const;
+    std::size_t getQuadsCount() const;
+    std::size_t getAllocatedBytesCount() const;
+
+  private:
+    bool isOutdated( const pos::ChunkPos& position ) const;
+
+  private:
+    std::unordered_map<pos::ChunkPos, ChunkMesh> m_meshes;
+
+    // Scratch of the meshing for every thread of the job system, kept between the updates
+    mutable std::vector<ChunkMesher::MesherContext> m_contexts;
+}; // class MeshRegistry
+
+}; // namespace chunk
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "chunk/block_id.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace chunk
+{
+
+/**
+ * Compressed storage of block ides. Every distinct block id is kept once in a small palette
+ * and the blocks themselves are stored as bit-packed indices into this palette.
+ * Storage with the only block id in the palette ( e.g. all air ) doesn't allocate indices at all.
+ */
+
+class PaletteStorage
+{
+  public:
+    explicit PaletteStorage( std::size_t size, BlockID initial = BlockID::k_none )
+        : m_size( size ),
+          m_palette{ initial }
+    {
+    }
+
+    std::size_t size() const { return m_size; }
+
+    // True if all the blocks have the same id. No index array is used in this case.
+    bool isUniform() const { return m_index_bits == 0; }
+
+    BlockID get( std::size_t index ) const
+    {
+        assert( index < m_size );
+
+        if ( isUniform() )
+        {
+            return m_palette[ 0 ];
+        }
+
+        return m_palette[ readIndex( index ) ];
+    } // PaletteStorage::get
+
+    void set( std::size_t index, BlockID block_id );
+
+    // Make all the blocks equal to block_id and release the index array
+    void fill( BlockID block_id );
+
+    // Bulk unpack all the blocks to the plain array of size()
+    void decode( std::span<BlockID> blocks ) const;
+
+    // Bulk pack the plain array of size() into the storage with the minimal palette
+    void encode( std::span<const BlockID> blocks );
+
+    // Remove unused palette entries and use the smallest possible index width
+    void shrinkToFit();
+
+    std::size_t getAllocatedBytesCount() const
+    {
+        return m_palette.capacity() * sizeof( BlockID ) + m_indices.capacity() * sizeof( Word );
+    }
+
+  private:
+    using Word = uint64_t;
+
+    static constexpr uint32_t k_word_bits_log2 = 6;
+
+    // Indices never cross the word boundary, so only power of two widths are used
+    static uint32_t indexBitsFor( std::size_t palette_size );
+
+    uint32_t readIndex( std::size_t index ) const
+    {
+        const auto per_word_log2 = k_word_bits_log2 - m_index_bits_log2;
+        const auto word = m_indices[ index >> per_word_log2 ];
+        const auto shift = ( index & ( ( std::size_t{ 1 } << per_word_log2 ) - 1 ) ) << m_index_bits_log2;
+
+        return static_cast<uint32_t>( ( word >> shift ) & m_index_mask );
+    } // PaletteStorage::readIndex
+
+    void writeIndex( std::size_t index, uint32_t palette_index )
+    {
+        const auto per_word_log2 = k_word_bits_log2 - m_index_bits_log2;
+        auto& word = m_indices[ index >> per_word_log2 ];
+        const auto shift = ( index & ( ( std::size_t{ 1 } << per_word_log2 ) - 1 ) ) << m_index_bits_log2;
+
+        word = ( word & ~( m_index_mask << shift ) ) | ( Word{ palette_index } << shift );
+    } // PaletteStorage::writeIndex
+
+    // Repack indices using the new width. New width should be able to represent all palette entries
+    void repack( uint32_t new_index_bits );
+
+  private:
+    std::size_t m_size;
+    std::vector<BlockID> m_palette;
+    std::vector<Word> m_indices;
+
+    uint32_t m_index_bits = 0; /* 0 means uniform storage */
+    uint32_t m_index_bits_log2 = 0;
+    Word m_index_mask = 0;
+}; // class PaletteStorage
+
+}; // namespace chunk
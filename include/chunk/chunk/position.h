@@ -1,7 +1,10 @@
 #pragma once
 
+#include <boost/functional/hash.hpp>
+
 #include <compare>
 #include <cstdint>
+#include <functional>
 
 namespace pos
 {
@@ -54,4 +57,38 @@ class ChunkPos
     int y;
 }; // class ChunkPos
 
+/**
+ * Position of the block in the world. Blocks of the chunk ( x, y ) have coordinates
+ * [ 16 * x, 16 * x + 16 ) and [ 16 * y, 16 * y + 16 ), Z is the height
+ */
+
+struct BlockPos
+{
+    int x;
+    int y;
+    int z;
+
+    friend bool operator==( const BlockPos& lhs, const BlockPos& rhs ) = default;
+}; // struct BlockPos
+
 }; // namespace pos
+
+/**
+ * Class containing hash function for std::unordered_map
+ */
+namespace std
+{
+
+template <> struct hash<pos::ChunkPos>
+{
+    size_t operator()( const pos::ChunkPos& chunk_pos ) const
+    {
+        std::hash<decltype( chunk_pos.x )> hasher;
+        size_t seed = 0;
+        boost::hash_combine( seed, hasher( chunk_pos.x ) );
+        boost::hash_combine( seed, hasher( chunk_pos.y ) );
+        return seed;
+    }
+}; // struct ChunkHasher
+
+} // namespace std
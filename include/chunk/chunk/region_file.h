@@ -0,0 +1,140 @@
+#pragma once
+
+#include "chunk/chunk.h"
+#include "chunk/mapped_file.h"
+#include "chunk/position.h"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace chunk
+{
+
+/*
+ * File with the compressed chunks of a region, that is a square of k_region_side x k_region_side chunks.
+ * The file starts with the header: magic, version and the offset table with an entry for every chunk
+ * of the region. Chunks are appended to the end of the file, so a rewritten chunk leaves its old copy unused.
+ * Chunks are read from the memory mapping of the file and decompressed right from the mapped pages.
+ */
+class RegionFile
+{
+  public:
+    static constexpr auto k_region_side = 32;
+    static constexpr auto k_chunks_count = k_region_side * k_region_side;
+
+  public:
+    // Open the region file. The file that doesn't exist is created on the first write
+    explicit RegionFile( std::filesystem::path path );
+
+    // Region containing the chunk
+    static pos::ChunkPos getRegionPos( const pos::ChunkPos& chunk_pos )
+    {
+        return pos::ChunkPos{ floorDiv( chunk_pos.x ), floorDiv( chunk_pos.y ) };
+    }
+
+    bool hasChunk( const pos::ChunkPos& chunk_pos ) const;
+
+    // Load the blocks of the chunk at its position. Return false if the chunk is not saved or corrupted
+    bool loadChunk( Chunk& chunk );
+    void writeChunk( const pos::ChunkPos& chunk_pos, std::span<const uint8_t> data );
+
+    // Start reading the saved chunks in the background. Chunks of other regions are ignored
+    void prefetchChunks( std::span<const pos::ChunkPos> positions ) const;
+
+  private:
+    struct TableEntry
+    {
+        uint64_t offset; /* 0 for the chunk that is not saved */
+        uint32_t size;
+    };
+
+    static constexpr std::array<char, 4> k_magic = { 'M', 'C', 'R', 'G' };
+    static constexpr uint32_t k_version = 1;
+
+    static constexpr std::size_t k_entry_size = sizeof( uint64_t ) + sizeof( uint32_t );
+    static constexpr std::size_t k_table_offset = k_magic.size() + sizeof( uint32_t );
+    static constexpr std::size_t k_header_size = k_table_offset + k_chunks_count * k_entry_size;
+
+    // Chunks closer than this in the file are read ahead by one request
+    static constexpr uint64_t k_prefetch_gap = 16 * 1024;
+
+  private:
+    static int floorDiv( int coord ) { return ( coord >= 0 ? coord : coord - k_region_side + 1 ) / k_region_side; }
+
+    static std::size_t getLocalIndex( const pos::ChunkPos& chunk_pos );
+
+    bool isMapped( const TableEntry& entry ) const
+    {
+        return m_mapping.has_value() && entry.offset + entry.size <= m_mapping->getSize();
+    }
+
+    void readHeader();
+    void createFile();
+    void writeTableEntry( std::size_t index );
+
+  private:
+    std::filesystem::path m_path;
+    std::optional<MappedFile> m_mapping; /* the file could grow since it was mapped */
+    std::fstream m_file;                 /* opened for writes only */
+    std::array<TableEntry, k_chunks_count> m_table{};
+
+    // Chunks are loaded and saved by several jobs at once. Loads share the lock, so they run in parallel
+    mutable std::shared_mutex m_mutex;
+}; // class RegionFile
+
+/*
+ * Directory of the region files of the world. The directory keeps the metadata of the world as well:
+ * the seed the saved chunks were generated with, so the rest of the world is generated to match them
+ */
+class RegionStorage
+{
+  public:
+    // Open the world in the directory. The new world is created with the seed, the existing one keeps its own
+    RegionStorage( std::filesystem::path directory, uint32_t seed );
+
+    uint32_t getSeed() const { return m_seed; }
+
+    // Load the blocks of the chunk at its position. Return false if the chunk is not saved or corrupted
+    bool loadChunk( Chunk& chunk );
+    void saveChunk( const Chunk& chunk );
+
+    // Save the chunk already compressed with compressChunk()
+    void saveCompressedChunk( const pos::ChunkPos& position, std::span<const uint8_t> data );
+
+    // Start reading the saved chunks in the background, before they are loaded
+    void prefetchChunks( std::span<const pos::ChunkPos> positions );
+
+  private:
+    // Unused files are closed when there are too many of them opened
+    static constexpr std::size_t k_max_opened_regions = 16;
+
+    static constexpr std::array<char, 4> k_metadata_magic = { 'M', 'C', 'W', 'D' };
+    static constexpr uint32_t k_metadata_version = 1;
+    static constexpr std::size_t k_metadata_size = k_metadata_magic.size() + 2 * sizeof( uint32_t );
+    static constexpr auto k_metadata_file_name = "world.meta";
+
+  private:
+    std::shared_ptr<RegionFile> getRegionFile( const pos::ChunkPos& chunk_pos );
+
+    // Read the metadata of the world, return false if the world is new
+    bool readMetadata();
+    void writeMetadata() const;
+
+  private:
+    std::filesystem::path m_directory;
+    uint32_t m_seed;
+
+    std::mutex m_mutex;
+    std::unordered_map<pos::ChunkPos, std::shared_ptr<RegionFile>> m_regions;
+}; // class RegionStorage
+
+}; // namespace chunk
@@ -5,6 +5,7 @@
 #include "vkwrap/pipeline_cfgs.h"
 
 #include <concepts>
+#include <span>
 #include <type_traits>
 
 namespace vkwrap
@@ -99,13 +100,18 @@ using DefaultPipelineBuilder = PipelineBuilder<
 template <ranges::range Range>
     requires std::same_as<ranges::range_value_t<Range>, vk::DescriptorSetLayout>
 vk::UniquePipelineLayout
-createPipelineLayout( vk::Device device, Range&& layouts )
+createPipelineLayout(
+    vk::Device device,
+    Range&& layouts,
+    std::span<const vk::PushConstantRange> push_constant_ranges = {} )
 {
     auto layouts_vec = ranges::views::all( layouts ) | ranges::to_vector;
 
     vk::PipelineLayoutCreateInfo layout_create_info{
         .setLayoutCount = static_cast<uint32_t>( layouts_vec.size() ),
-        .pSetLayouts = layouts_vec.data() };
+        .pSetLayouts = layouts_vec.data(),
+        .pushConstantRangeCount = static_cast<uint32_t>( push_constant_ranges.size() ),
+        .pPushConstantRanges = push_constant_ranges.data() };
 
     return device.createPipelineLayoutUnique( layout_create_info );
 }
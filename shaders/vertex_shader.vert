@@ -4,27 +4,62 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 proj;
-
-    vec2 origin_pos;
 } ubo;
 
+// Position of the drawn chunk, the vertices are relative to the chunk
+layout(push_constant) uniform PushConstants {
+    ivec2 chunk_pos;
+} chunk;
+
 
 layout(location = 0) in uint in_vertex_data;
 layout(location = 1) in uint in_tex_data;
 
 layout(location = 0) out vec3 frag_tex_coord;
 
+#ifdef QUAD_FORMAT
+// One quad per instance, its vertices are the corners ( du, dv ) = ( corner & 1, corner >> 1 ) of the face.
+// Triangles of the back faces are in the reversed order
+const uint k_front_corners[ 6 ] = uint[]( 0u, 1u, 2u, 1u, 3u, 2u );
+const uint k_back_corners[ 6 ] = uint[]( 2u, 3u, 1u, 2u, 1u, 0u );
+#endif
+
 void main() {
+#ifdef QUAD_FORMAT
+    uint dim = ( in_vertex_data >> 19 ) & 0x3u;
+    bool is_front_face = ( ( in_vertex_data >> 21 ) & 0x1u ) != 0u;
+
+    uint corner = is_front_face ? k_front_corners[ gl_VertexIndex ] : k_back_corners[ gl_VertexIndex ];
+    float du = float( corner & 1u );
+    float dv = float( corner >> 1u );
+
+    float width = float( in_tex_data & 0x000001FF );
+    float height = float( ( in_tex_data & 0x0003FE00 ) >> 9 );
+
+    // the face lies in the plane OUV, U = { Y, Z, X } and V = { Z, X, Y } for the axes X, Y, Z
+    vec3 position = vec3( float( in_vertex_data & 0x1F ),
+                          float( ( in_vertex_data >> 5 ) & 0x1F ),
+                          float( ( in_vertex_data >> 10 ) & 0x1FF ) );
+    position[ ( dim + 1u ) % 3u ] += du * width;
+    position[ ( dim + 2u ) % 3u ] += dv * height;
+
+    float x = position.x;
+    float y = position.y;
+    float z = position.z;
+    float u = du * width;
+    float v = dv * height;
+#else
     float x = float( in_vertex_data & 0x000007FF );
     float y = float( ( in_vertex_data & 0x003FF800 ) >> 11 );
     float z = float( in_vertex_data >> 22 );
-    x += ( ubo.origin_pos.x ) * 16;
-    y += ( ubo.origin_pos.y ) * 16;
+    float u = float( in_tex_data & 0x000001FF );
+    float v = float( ( in_tex_data & 0x0003FE00 ) >> 9 );
+#endif
+    x += float( chunk.chunk_pos.x * 16 );
+    y += float( chunk.chunk_pos.y * 16 );
 
     gl_Position = ubo.proj * ubo.view * ubo.model * vec4(x, y, z, 1.0);
 
-    float u = float( in_tex_data & 0x000001FF );
-    float v = float( ( in_tex_data & 0x0003FE00 ) >> 9 );
     float id = float( in_tex_data >> 18 ) - 1;
 
     frag_tex_coord = vec3( u, v, id );
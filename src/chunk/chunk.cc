@@ -0,0 +1,382 @@
+#include "chunk/chunk.h"
+
+#include <algorithm>
+
+namespace chunk
+{
+
+void
+Chunk::set( int index, BlockID block_id )
+{
+    assert( index < k_block_count );
+
+    auto& section = m_sections[ index / k_section_block_count ];
+    m_is_modified = true;
+
+    if ( !section )
+    {
+        if ( block_id == BlockID::k_none )
+        {
+            return;
+        }
+
+        section = std::make_unique<PaletteStorage>( k_section_block_count );
+    }
+
+    section->set( index % k_section_block_count, block_id );
+
+    const auto local_pos = BlockLayout::toSectionPos( index % k_section_block_count );
+    const auto column = toColumnIndex( local_pos.x, local_pos.y );
+    const auto z = ( index / k_section_block_count ) * k_section_height + local_pos.z;
+
+    auto& top = m_column_tops[ column ];
+    auto& bottom = m_column_bottoms[ column ];
+
+    if ( block_id != BlockID::k_none )
+    {
+        if ( z >= top || z < bottom )
+        {
+            top = static_cast<int16_t>( std::max<int>( top, z + 1 ) );
+            bottom = static_cast<int16_t>( std::min<int>( bottom, z ) );
+            updateHeightRange();
+        }
+    } else if ( z + 1 == top || z == bottom )
+    {
+        scanColumn( column );
+        updateHeightRange();
+    }
+} // Chunk::set
+
+Chunk::SectionsRange
+Chunk::getSectionsRange() const
+{
+    auto is_present = []( const SectionPtr& section ) { return static_cast<bool>( section ); };
+
+    auto first = std::find_if( m_sections.begin(), m_sections.end(), is_present );
+    if ( first == m_sections.end() )
+    {
+        return SectionsRange{ .begin = 0, .end = 0 };
+    }
+
+    auto last = std::find_if( m_sections.rbegin(), m_sections.rend(), is_present );
+
+    return SectionsRange{
+        .begin = static_cast<int>( first - m_sections.begin() ),
+        .end = static_cast<int>( m_sections.rend() - last ) };
+} // Chunk::getSectionsRange
+
+void
+Chunk::fill( BlockID block_id )
+{
+    for ( int section = 0; section < k_sections_count; ++section )
+    {
+        fillSection( section, block_id );
+    }
+} // Chunk::fill
+
+void
+Chunk::fillSection( int section, BlockID block_id )
+{
+    assert( section < k_sections_count );
+    m_is_modified = true;
+
+    if ( block_id == BlockID::k_none )
+    {
+        m_sections[ section ].reset();
+    } else if ( !m_sections[ section ] )
+    {
+        m_sections[ section ] = std::make_unique<PaletteStorage>( k_section_block_count, block_id );
+    } else
+    {
+        m_sections[ section ]->fill( block_id );
+    }
+
+    const auto end = ( block_id == BlockID::k_none ) ? 0 : k_section_height;
+
+    for ( int column = 0; column < k_columns_count; column++ )
+    {
+        updateColumn( column, section, 0, end );
+    }
+
+    updateHeightRange();
+} // Chunk::fillSection
+
+void
+Chunk::decode( std::span<BlockID, k_block_count> blocks ) const
+{
+    for ( int section = 0; section < k_sections_count; ++section )
+    {
+        decodeSection( section, blocks.subspan( section * k_section_block_count ).first<k_section_block_count>() );
+    }
+} // Chunk::decode
+
+void
+Chunk::decodeSection( int section, std::span<BlockID, k_section_block_count> blocks ) const
+{
+    assert( section < k_sections_count );
+
+    if ( const auto& storage = m_sections[ section ]; storage )
+    {
+        storage->decode( blocks );
+    } else
+    {
+        std::fill( blocks.begin(), blocks.end(), BlockID::k_none );
+    }
+} // Chunk::decodeSection
+
+void
+Chunk::encode( std::span<const BlockID, k_block_count> blocks )
+{
+    for ( int section = 0; section < k_sections_count; ++section )
+    {
+        encodeSection( section, blocks.subspan( section * k_section_block_count ).first<k_section_block_count>() );
+    }
+} // Chunk::encode
+
+void
+Chunk::encodeSection( int section, std::span<const BlockID, k_section_block_count> blocks )
+{
+    assert( section < k_sections_count );
+    m_is_modified = true;
+
+    auto is_air = []( BlockID block_id ) { return block_id == BlockID::k_none; };
+
+    if ( std::all_of( blocks.begin(), blocks.end(), is_air ) )
+    {
+        m_sections[ section ].reset();
+    } else
+    {
+        if ( !m_sections[ section ] )
+        {
+            m_sections[ section ] = std::make_unique<PaletteStorage>( k_section_block_count );
+        }
+
+        m_sections[ section ]->encode( blocks );
+    }
+
+    updateSectionColumns( section, blocks );
+} // Chunk::encodeSection
+
+void
+Chunk::decodeSectionLinear( int section, std::span<BlockID, k_section_block_count> blocks ) const
+{
+    if constexpr ( BlockLayout::k_is_linear )
+    {
+        decodeSection( section, blocks );
+    } else
+    {
+        thread_local std::array<BlockID, k_section_block_count> layout_blocks{};
+        decodeSection( section, layout_blocks );
+
+        for ( int index = 0, x = 0; x < k_max_width_length; x++ )
+        {
+            for ( int y = 0; y < k_max_width_length; y++ )
+            {
+                for ( int z = 0; z < k_section_height; z++ )
+                {
+                    blocks[ index++ ] = layout_blocks[ BlockLayout::toSectionIndex( x, y, z ) ];
+                }
+            }
+        }
+    }
+} // Chunk::decodeSectionLinear
+
+void
+Chunk::encodeSectionLinear( int section, std::span<const BlockID, k_section_block_count> blocks )
+{
+    if constexpr ( BlockLayout::k_is_linear )
+    {
+        encodeSection( section, blocks );
+    } else
+    {
+        thread_local std::array<BlockID, k_section_block_count> layout_blocks{};
+
+        for ( int index = 0, x = 0; x < k_max_width_length; x++ )
+        {
+            for ( int y = 0; y < k_max_width_length; y++ )
+            {
+                for ( int z = 0; z < k_section_height; z++ )
+                {
+                    layout_blocks[ BlockLayout::toSectionIndex( x, y, z ) ] = blocks[ index++ ];
+                }
+            }
+        }
+
+        encodeSection( section, layout_blocks );
+    }
+} // Chunk::encodeSectionLinear
+
+void
+Chunk::readSlice( int axis, int coord, int z_begin, int z_end, std::span<BlockID, k_max_slice_size> slice ) const
+{
+    assert( axis >= 0 && axis < 3 );
+
+    // the block ( u, v ) of the plane, see extractSlice()
+    auto read_block = [ this, axis, coord ]( int u, int v ) {
+        switch ( axis )
+        {
+        case 0:
+            return ( *this )[ toIndex( coord, u, v ) ];
+        case 1:
+            return ( *this )[ toIndex( v, coord, u ) ];
+        default:
+            return ( *this )[ toIndex( u, v, coord ) ];
+        }
+    };
+
+    const auto u_size = ( axis == 1 ) ? k_max_height : k_max_width_length;
+    const auto v_size = ( axis == 0 ) ? k_max_height : k_max_width_length;
+
+    for ( int v = 0; v < v_size; v++ )
+    {
+        for ( int u = 0; u < u_size; u++ )
+        {
+            const auto z = ( axis == 0 ) ? v : ( axis == 1 ) ? u : coord;
+
+            if ( z >= z_begin && z < z_end )
+            {
+                slice[ v * u_size + u ] = read_block( u, v );
+            }
+        }
+    }
+} // Chunk::readSlice
+
+void
+Chunk::shrinkToFit()
+{
+    for ( auto& section : m_sections )
+    {
+        if ( !section )
+        {
+            continue;
+        }
+
+        section->shrinkToFit();
+
+        if ( section->isUniform() && section->get( 0 ) == BlockID::k_none )
+        {
+            section.reset();
+        }
+    }
+} // Chunk::shrinkToFit
+
+std::size_t
+Chunk::getAllocatedBytesCount() const
+{
+    std::size_t bytes_count = 0;
+
+    for ( const auto& section : m_sections )
+    {
+        if ( section )
+        {
+            bytes_count += sizeof( PaletteStorage ) + section->getAllocatedBytesCount();
+        }
+    }
+
+    return bytes_count;
+} // Chunk::getAllocatedBytesCount
+
+void
+Chunk::updateColumn( int column, int section, int begin, int end )
+{
+    const auto section_bottom = section * k_section_height;
+    const auto section_top = section_bottom + k_section_height;
+
+    auto& top = m_column_tops[ column ];
+    auto& bottom = m_column_bottoms[ column ];
+
+    if ( begin >= end )
+    {
+        // Blocks at the top or at the bottom of the column could be removed, the next ones are in other sections
+        if ( ( top > section_bottom && top <= section_top ) || ( bottom >= section_bottom && bottom < section_top ) )
+        {
+            scanColumn( column );
+        }
+
+        return;
+    }
+
+    // Sections above the top and below the bottom have only air in the column
+    if ( top <= section_top )
+    {
+        top = static_cast<int16_t>( section_bottom + end );
+    }
+
+    if ( bottom >= section_bottom )
+    {
+        bottom = static_cast<int16_t>( section_bottom + begin );
+    }
+} // Chunk::updateColumn
+
+void
+Chunk::updateSectionColumns( int section, std::span<const BlockID, k_section_block_count> blocks )
+{
+    for ( int x = 0; x < k_max_width_length; x++ )
+    {
+        for ( int y = 0; y < k_max_width_length; y++ )
+        {
+            int begin = k_section_height;
+            int end = 0;
+
+            for ( int z = 0; z < k_section_height; z++ )
+            {
+                if ( blocks[ BlockLayout::toSectionIndex( x, y, z ) ] != BlockID::k_none )
+                {
+                    begin = std::min( begin, z );
+                    end = z + 1;
+                }
+            }
+
+            updateColumn( toColumnIndex( x, y ), section, begin, end );
+        }
+    }
+
+    updateHeightRange();
+} // Chunk::updateSectionColumns
+
+void
+Chunk::scanColumn( int column )
+{
+    const auto x = column / k_max_width_length;
+    const auto y = column % k_max_width_length;
+
+    int top = 0;
+    int bottom = k_max_height;
+
+    for ( int section = 0; section < k_sections_count; section++ )
+    {
+        if ( !m_sections[ section ] )
+        {
+            continue;
+        }
+
+        for ( int z = section * k_section_height; z < ( section + 1 ) * k_section_height; z++ )
+        {
+            if ( ( *this )[ toIndex( x, y, z ) ] != BlockID::k_none )
+            {
+                bottom = std::min( bottom, z );
+                top = z + 1;
+            }
+        }
+    }
+
+    m_column_tops[ column ] = static_cast<int16_t>( top );
+    m_column_bottoms[ column ] = static_cast<int16_t>( bottom );
+} // Chunk::scanColumn
+
+void
+Chunk::updateHeightRange()
+{
+    const auto end = *std::max_element( m_column_tops.begin(), m_column_tops.end() );
+
+    if ( end == 0 )
+    {
+        m_height_range = HeightRange{ .begin = 0, .end = 0 };
+        return;
+    }
+
+    const auto begin = *std::min_element( m_column_bottoms.begin(), m_column_bottoms.end() );
+    m_height_range = HeightRange{ .begin = begin, .end = end };
+} // Chunk::updateHeightRange
+
+}; // namespace chunk
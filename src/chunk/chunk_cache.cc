@@ -0,0 +1,99 @@
+#include "chunk/chunk_cache.h"
+#include "chunk/chunk_codec.h"
+
+#include <iterator>
+#include <utility>
+
+namespace chunk
+{
+
+ChunkCache::ChunkCache( std::size_t budget_bytes )
+    : m_budget_bytes( budget_bytes )
+{
+} // ChunkCache::ChunkCache
+
+void
+ChunkCache::put( const pos::ChunkPos& position, std::vector<uint8_t> data, bool is_modified )
+{
+    data.shrink_to_fit();
+
+    auto lock = std::lock_guard{ m_mutex };
+
+    if ( auto found = m_index.find( position ); found != m_index.end() )
+    {
+        erase( found->second );
+    }
+
+    m_entries.push_front( Entry{ .position = position, .data = std::move( data ), .is_modified = is_modified } );
+    m_index.emplace( position, m_entries.begin() );
+    m_used_bytes += getEntryBytes( m_entries.front() );
+
+    // Drop the least recent chunks. The chunk that is larger than the whole budget is dropped as well
+    while ( m_used_bytes > m_budget_bytes && !m_entries.empty() )
+    {
+        erase( std::prev( m_entries.end() ) );
+    }
+} // ChunkCache::put
+
+bool
+ChunkCache::take( Chunk& chunk )
+{
+    auto taken = EntryList{};
+
+    {
+        auto lock = std::lock_guard{ m_mutex };
+        auto found = m_index.find( chunk.getPosition() );
+
+        if ( found == m_index.end() )
+        {
+            m_misses_count++;
+            return false;
+        }
+
+        m_hits_count++;
+        m_used_bytes -= getEntryBytes( *found->second );
+        taken.splice( taken.end(), m_entries, found->second );
+        m_index.erase( found );
+    }
+
+    // Decompression doesn't need the lock
+    const auto& entry = taken.front();
+    if ( !decompressChunk( entry.data, chunk ) )
+    {
+        return false;
+    }
+
+    chunk.setModified( entry.is_modified );
+    return true;
+} // ChunkCache::take
+
+std::size_t
+ChunkCache::getUsedBytes() const
+{
+    auto lock = std::lock_guard{ m_mutex };
+    return m_used_bytes;
+} // ChunkCache::getUsedBytes
+
+std::size_t
+ChunkCache::getHitsCount() const
+{
+    auto lock = std::lock_guard{ m_mutex };
+    return m_hits_count;
+} // ChunkCache::getHitsCount
+
+std::size_t
+ChunkCache::getMissesCount() const
+{
+    auto lock = std::lock_guard{ m_mutex };
+    return m_misses_count;
+} // ChunkCache::getMissesCount
+
+void
+ChunkCache::erase( EntryList::iterator entry )
+{
+    m_used_bytes -= getEntryBytes( *entry );
+    m_index.erase( entry->position );
+    m_entries.erase( entry );
+} // ChunkCache::erase
+
+}; // namespace chunk
@@ -0,0 +1,255 @@
+#include "chunk/chunk_codec.h"
+
+#include <algorithm>
+#include <array>
+
+namespace chunk
+{
+
+namespace
+{
+
+// Increased on every change of the format
+constexpr uint8_t k_codec_version = 1;
+
+enum class SectionTag : uint8_t
+{
+    k_absent,
+    k_uniform,
+    k_runs
+};
+
+// Numbers are little endian, run lengths are LEB128 varints
+class ByteWriter
+{
+  public:
+    explicit ByteWriter( std::vector<uint8_t>& data )
+        : m_data( data )
+    {
+    }
+
+    void writeByte( uint8_t value ) { m_data.push_back( value ); }
+
+    void writeBlockID( BlockID block_id )
+    {
+        const auto value = utils::toUnderlying( block_id );
+
+        writeByte( static_cast<uint8_t>( value ) );
+        writeByte( static_cast<uint8_t>( value >> 8 ) );
+    }
+
+    void writeVarUint( uint32_t value )
+    {
+        while ( value >= 0x80 )
+        {
+            writeByte( static_cast<uint8_t>( value | 0x80 ) );
+            value >>= 7;
+        }
+
+        writeByte( static_cast<uint8_t>( value ) );
+    }
+
+  private:
+    std::vector<uint8_t>& m_data;
+}; // class ByteWriter
+
+// Every read returns false if there is not enough data or the value is invalid
+class ByteReader
+{
+  public:
+    explicit ByteReader( std::span<const uint8_t> data )
+        : m_data( data )
+    {
+    }
+
+    bool isEnd() const { return m_position == m_data.size(); }
+
+    bool readByte( uint8_t& value )
+    {
+        if ( isEnd() )
+        {
+            return false;
+        }
+
+        value = m_data[ m_position++ ];
+        return true;
+    }
+
+    bool readBlockID( BlockID& block_id )
+    {
+        uint8_t low = 0;
+        uint8_t high = 0;
+
+        if ( !readByte( low ) || !readByte( high ) )
+        {
+            return false;
+        }
+
+        const auto value = static_cast<uint16_t>( low | ( high << 8 ) );
+        if ( value >= utils::toUnderlying( BlockID::k_max ) )
+        {
+            return false;
+        }
+
+        block_id = static_cast<BlockID>( value );
+        return true;
+    }
+
+    bool readVarUint( uint32_t& value )
+    {
+        value = 0;
+
+        for ( int shift = 0; shift < 32; shift += 7 )
+        {
+            uint8_t byte = 0;
+            if ( !readByte( byte ) )
+            {
+                return false;
+            }
+
+            value |= static_cast<uint32_t>( byte & 0x7f ) << shift;
+            if ( !( byte & 0x80 ) )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+  private:
+    std::span<const uint8_t> m_data;
+    std::size_t m_position = 0;
+}; // class ByteReader
+
+void
+compressSectionRuns( ByteWriter& writer, std::span<const BlockID, Chunk::k_section_block_count> blocks )
+{
+    for ( auto run_begin = blocks.begin(); run_begin != blocks.end(); )
+    {
+        const auto run_end = std::find_if( run_begin, blocks.end(), [ run_begin ]( BlockID block_id ) {
+            return block_id != *run_begin;
+        } );
+
+        writer.writeBlockID( *run_begin );
+        writer.writeVarUint( static_cast<uint32_t>( run_end - run_begin ) );
+        run_begin = run_end;
+    }
+}
+
+bool
+decompressSectionRuns( ByteReader& reader, std::span<BlockID, Chunk::k_section_block_count> blocks )
+{
+    // Runs cover the section exactly, so there is no runs count
+    for ( auto run_begin = blocks.begin(); run_begin != blocks.end(); )
+    {
+        auto block_id = BlockID::k_none;
+        uint32_t run_length = 0;
+
+        if ( !reader.readBlockID( block_id ) || !reader.readVarUint( run_length ) || run_length == 0 ||
+             run_length > static_cast<uint32_t>( blocks.end() - run_begin ) )
+        {
+            return false;
+        }
+
+        run_begin = std::fill_n( run_begin, run_length, block_id );
+    }
+
+    return true;
+}
+
+} // namespace
+
+std::vector<uint8_t>
+compressChunk( const Chunk& chunk )
+{
+    thread_local std::array<BlockID, Chunk::k_section_block_count> blocks{};
+
+    std::vector<uint8_t> data;
+    auto writer = ByteWriter{ data };
+
+    writer.writeByte( k_codec_version );
+
+    for ( int section = 0; section < Chunk::k_sections_count; section++ )
+    {
+        switch ( chunk.getSectionState( section ) )
+        {
+        case Chunk::SectionState::k_absent:
+            writer.writeByte( utils::toUnderlying( SectionTag::k_absent ) );
+            break;
+        case Chunk::SectionState::k_uniform:
+            writer.writeByte( utils::toUnderlying( SectionTag::k_uniform ) );
+            writer.writeBlockID( chunk[ section * Chunk::k_section_block_count ] );
+            break;
+        case Chunk::SectionState::k_dense:
+            writer.writeByte( utils::toUnderlying( SectionTag::k_runs ) );
+            chunk.decodeSectionLinear( section, blocks );
+            compressSectionRuns( writer, blocks );
+            break;
+        default:
+            assert( 0 && "Unknown section state" );
+        }
+    }
+
+    return data;
+} // compressChunk
+
+bool
+decompressChunk( std::span<const uint8_t> data, Chunk& chunk )
+{
+    thread_local std::array<BlockID, Chunk::k_section_block_count> blocks{};
+
+    auto reader = ByteReader{ data };
+    uint8_t version = 0;
+
+    if ( !reader.readByte( version ) || version != k_codec_version )
+    {
+        return false;
+    }
+
+    for ( int section = 0; section < Chunk::k_sections_count; section++ )
+    {
+        uint8_t tag = 0;
+        auto block_id = BlockID::k_none;
+
+        if ( !reader.readByte( tag ) )
+        {
+            return false;
+        }
+
+        switch ( static_cast<SectionTag>( tag ) )
+        {
+        case SectionTag::k_absent:
+            chunk.fillSection( section, BlockID::k_none );
+            break;
+        case SectionTag::k_uniform:
+            if ( !reader.readBlockID( block_id ) )
+            {
+                return false;
+            }
+
+            chunk.fillSection( section, block_id );
+            break;
+        case SectionTag::k_runs:
+            if ( !decompressSectionRuns( reader, blocks ) )
+            {
+                return false;
+            }
+
+            chunk.encodeSectionLinear( section, blocks );
+            break;
+        default:
+            return false;
+        }
+    }
+
+    if ( !reader.isEnd() )
+    {
+        return false;
+    }
+
+    chunk.setModified( false );
+    return true;
+} // decompressChunk
+
+}; // namespace chunk
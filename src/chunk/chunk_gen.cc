@@ -6,8 +6,11 @@
 #include <range/v3/view/cartesian_product.hpp>
 #include <range/v3/view/iota.hpp>
 
+#include <algorithm>
+#include <array>
 #include <cstdlib>
 #include <limits>
+#include <optional>
 #include <random>
 
 namespace chunk
@@ -16,47 +19,105 @@ namespace chunk
 namespace
 {
 
+std::optional<uint32_t> g_generation_seed = std::nullopt;
+
+struct ColumnLevels
+{
+    double stone_level;
+    double dirt_level;
+};
+
+BlockID
+getBlockAtHeight( const ColumnLevels& levels, int z )
+{
+    const float rel_height = static_cast<float>( z ) / Chunk::k_max_height;
+
+    if ( rel_height < levels.stone_level )
+    {
+        return BlockID::k_stone;
+    } else if ( rel_height < levels.dirt_level )
+    {
+        return BlockID::k_dirt;
+    }
+
+    return BlockID::k_none;
+}
+
 void
 perlinChunkGen( Chunk& chunk )
 {
-    static auto noise = siv::PerlinNoise{ std::random_device{} };
+    // Noise is only read after the initialization, so it's shared between the generating threads
+    static const auto noise = siv::PerlinNoise{ getGenerationSeed() };
 
     const auto iota = ranges::views::iota( 0, Chunk::k_max_width_length );
     const auto pos = chunk.getPosition();
 
+    // Noise depends only on the column, so sample it once per column instead of once per block
+    thread_local std::array<ColumnLevels, Chunk::k_max_width_length * Chunk::k_max_width_length> columns{};
+    auto max_level = 0.0;
+
     for ( auto&& [ local_x, local_y ] : ranges::views::cartesian_product( iota, iota ) )
     {
         const float absoulute_x = pos.x * Chunk::k_max_width_length + local_x;
         const float absoulute_y = pos.y * Chunk::k_max_width_length + local_y;
 
-        for ( auto z : ranges::views::iota( 0, Chunk::k_max_height ) )
-        {
-            const float rel_height = static_cast<float>( z ) / Chunk::k_max_height;
+        auto frequency = 0.03f;
 
-            BlockID block = BlockID::k_none;
-            auto frequency = 0.03f;
+        auto dirt_level = noise.octave2D_01( frequency * absoulute_x, frequency * absoulute_y, 4 ) * 0.075f + 0.075f;
+        auto stone_level = noise.octave2D_01( frequency * absoulute_x, frequency * absoulute_y, 2 ) * 0.125f + 0.05f;
 
-            auto dirt_level =
-                noise.octave2D_01( frequency * absoulute_x, frequency * absoulute_y, 4 ) * 0.075f + 0.075f;
+        columns[ local_x * Chunk::k_max_width_length + local_y ] = { stone_level, dirt_level };
+        max_level = std::max( { max_level, stone_level, dirt_level } );
+    }
 
-            auto stone_level =
-                noise.octave2D_01( frequency * absoulute_x, frequency * absoulute_y, 2 ) * 0.125f + 0.05f;
+    // Generate section by section into the plain array and pack it into the chunk.
+    // Sections above the highest column are left absent without touching the blocks
+    thread_local std::array<BlockID, Chunk::k_section_block_count> blocks{};
 
-            if ( rel_height < stone_level )
-            {
-                block = BlockID::k_stone;
-            } else if ( rel_height < dirt_level )
+    for ( auto section : ranges::views::iota( 0, Chunk::k_sections_count ) )
+    {
+        const auto section_bottom = section * Chunk::k_section_height;
+
+        if ( static_cast<float>( section_bottom ) / Chunk::k_max_height >= max_level )
+        {
+            chunk.fillSection( section, BlockID::k_none );
+            continue;
+        }
+
+        for ( auto&& [ local_x, local_y ] : ranges::views::cartesian_product( iota, iota ) )
+        {
+            const auto& levels = columns[ local_x * Chunk::k_max_width_length + local_y ];
+
+            for ( auto local_z : ranges::views::iota( 0, Chunk::k_section_height ) )
             {
-                block = BlockID::k_dirt;
+                blocks[ Chunk::toIndex( local_x, local_y, local_z ) ] =
+                    getBlockAtHeight( levels, section_bottom + local_z );
             }
-
-            chunk.at( local_x, local_y, z ) = block;
         }
+
+        chunk.encodeSection( section, blocks );
     }
 }
 
 } // namespace
 
+void
+setGenerationSeed( uint32_t seed )
+{
+    g_generation_seed = seed;
+} // setGenerationSeed
+
+uint32_t
+getGenerationSeed()
+{
+    if ( !g_generation_seed.has_value() )
+    {
+        g_generation_seed = std::random_device{}();
+    }
+
+    return g_generation_seed.value();
+} // getGenerationSeed
+
 void
 simpleChunkGen( Chunk& chunk_to_gen )
 {
@@ -1,128 +1,346 @@
 #include "chunk/chunk_man.h"
+#include "chunk/chunk_codec.h"
 #include "chunk/chunk_gen.h"
+#include "chunk/job_system.h"
+
+#include <algorithm>
+#include <array>
 
 namespace chunk
 {
 
-ChunkMan::ChunkMan( const pos::ChunkPos& origin_pos )
+ChunkMan::ChunkMan( const pos::ChunkPos& origin_pos, int render_distance )
     : m_origin_pos( origin_pos ),
-      m_block_ides( std::make_unique<std::array<BlockID, k_blocks_count>>() )
+      m_render_distance( 0 ),
+      m_side_length( 1 ),
+      m_cache( s_cache_budget_mb * 1024 * 1024 )
+{
+    if ( !s_world_directory.empty() )
+    {
+        // The existing world keeps its seed, otherwise the generated chunks don't match the saved ones
+        m_storage = std::make_unique<RegionStorage>( s_world_directory, getGenerationSeed() );
+        setGenerationSeed( m_storage->getSeed() );
+    }
+
+    setRenderDistance( render_distance );
+}; // ChunkMan::ChunkMan
+
+void
+ChunkMan::setRenderDistance( int render_distance )
 {
-    m_chunks.reserve( k_chunks_count );
-    auto* raw_block_ides_ptr = m_block_ides->data();
+    assert( render_distance >= k_min_render_distance && render_distance <= k_max_render_distance );
 
-    auto min_x = origin_pos.x - k_render_distance;
-    auto max_x = origin_pos.x + k_render_distance;
+    const auto new_side_length = 2 * render_distance + 1;
+    const auto new_chunks_count = new_side_length * new_side_length;
 
-    auto min_y = origin_pos.x - k_render_distance;
-    auto max_y = origin_pos.y + k_render_distance;
+    ChunkRing new_chunks;
+    new_chunks.reserve( new_chunks_count );
 
-    for ( auto x = min_x; x <= max_x; x++ )
+    for ( auto slot = 0; slot < new_chunks_count; slot++ )
     {
-        for ( auto y = min_y; y <= max_y; y++ )
+        new_chunks.emplace_back( pos::ChunkPos{} );
+    }
+
+    StateRing new_states( new_chunks_count );
+    DirtyRing new_dirty_flags( new_chunks_count );
+
+    auto is_kept = [ this, render_distance ]( std::size_t slot ) {
+        const auto position = m_chunks[ slot ].getPosition();
+
+        return m_states[ slot ].load( std::memory_order_acquire ) != ChunkState::k_empty &&
+            std::abs( position.x - m_origin_pos.x ) <= render_distance &&
+            std::abs( position.y - m_origin_pos.y ) <= render_distance;
+    };
+
+    std::vector<std::size_t> evicted_slots;
+
+    for ( std::size_t slot = 0; slot < m_chunks.size(); slot++ )
+    {
+        if ( !is_kept( slot ) && m_states[ slot ].load( std::memory_order_acquire ) != ChunkState::k_empty )
+        {
+            evicted_slots.push_back( slot );
+        }
+    }
+
+    evictChunks( evicted_slots );
+
+    // Slots depend on the side of the region, so the chunks that are still visible are moved to their new slots
+    // with their states and dirty flags. Empty slots left are generated
+    for ( std::size_t old_slot = 0; old_slot < m_chunks.size(); old_slot++ )
+    {
+        if ( !is_kept( old_slot ) )
+        {
+            continue;
+        }
+
+        auto& chunk = m_chunks[ old_slot ];
+        const auto position = chunk.getPosition();
+        const auto state = m_states[ old_slot ].load( std::memory_order_acquire );
+
+        assert( state != ChunkState::k_generating && state != ChunkState::k_meshing );
+
+        const auto slot = getSlotIndex( position, new_side_length );
+        new_chunks[ slot ] = std::move( chunk );
+        new_states[ slot ].store( state, std::memory_order_relaxed );
+        new_dirty_flags[ slot ].store( m_dirty_flags[ old_slot ].load( std::memory_order_acquire ) );
+    }
+
+    std::vector<pos::ChunkPos> new_positions;
+
+    for ( auto x = m_origin_pos.x - render_distance; x <= m_origin_pos.x + render_distance; x++ )
+    {
+        for ( auto y = m_origin_pos.y - render_distance; y <= m_origin_pos.y + render_distance; y++ )
         {
             auto position = pos::ChunkPos{ x, y };
-            auto tmp_chunk = Chunk{ raw_block_ides_ptr, position };
-            m_chunks.emplace( position, tmp_chunk );
-            simpleChunkGen( tmp_chunk );
-            raw_block_ides_ptr += Chunk::k_block_count;
+
+            if ( new_states[ getSlotIndex( position, new_side_length ) ] == ChunkState::k_empty )
+            {
+                new_positions.push_back( position );
+            }
         }
     }
-}; // ChunkMan::ChunkMan
 
-Chunk&
-ChunkMan::getChunk( const pos::ChunkPos& pos )
+    m_chunks = std::move( new_chunks );
+    m_states = std::move( new_states );
+    m_dirty_flags = std::move( new_dirty_flags );
+    m_render_distance = render_distance;
+    m_side_length = new_side_length;
+
+    generateChunks( new_positions );
+} // ChunkMan::setRenderDistance
+
+void
+ChunkMan::generateChunks( std::span<const pos::ChunkPos> positions )
 {
-    assert(
-        std::abs( pos.x - m_origin_pos.x ) <= k_render_distance &&
-        std::abs( pos.y - m_origin_pos.y ) <= k_render_distance );
+    if ( m_storage )
+    {
+        m_storage->prefetchChunks( positions );
+    }
 
-    auto res = m_chunks.find( pos );
+    // Every position has its own slot, so the chunks are generated independently
+    JobSystem::getRef().parallelFor( positions.size(), [ this, positions ]( std::size_t index ) {
+        const auto& position = positions[ index ];
+        const auto slot = getSlotIndex( position );
+        auto& chunk = m_chunks[ slot ];
 
-    /// [krisszzz]: In the future should use for example std::optional
-    assert( res != m_chunks.end() );
+        changeState( slot, ChunkState::k_empty, ChunkState::k_generating );
 
-    return res->second;
-} // ChunkMan::getChunk
+        chunk.setPosition( position );
+        loadOrGenerateChunk( chunk );
+
+        // New chunk is not meshed yet, so its mesh can't be out of date
+        m_dirty_flags[ slot ].store( false, std::memory_order_release );
+
+        changeState( slot, ChunkState::k_generating, ChunkState::k_generated );
+    } );
+} // ChunkMan::generateChunks
 
 void
 ChunkMan::changeOriginPos( const pos::ChunkPos& new_origin )
 {
-    constexpr auto chunk_distance_diff = 1;
+    // Find chunks of the new region that are not in the old one. The slot of such chunk is occupied
+    // by the chunk that left the region ( they are equal modulo side length ), so the chunk
+    // in the slot is either already the right one or should be regenerated.
+    std::vector<pos::ChunkPos> new_positions;
+    std::vector<std::size_t> evicted_slots;
+
+    for ( auto x = new_origin.x - m_render_distance; x <= new_origin.x + m_render_distance; x++ )
+    {
+        for ( auto y = new_origin.y - m_render_distance; y <= new_origin.y + m_render_distance; y++ )
+        {
+            const auto position = pos::ChunkPos{ x, y };
+            const auto slot = getSlotIndex( position );
 
-    const pos::ChunkPos player_direction{ new_origin.x - m_origin_pos.x, new_origin.y - m_origin_pos.y };
+            if ( m_states[ slot ].load( std::memory_order_acquire ) == ChunkState::k_empty )
+            {
+                new_positions.push_back( position );
+            } else if ( m_chunks[ slot ].getPosition() != position )
+            {
+                // The chunk in the slot left the region
+                evicted_slots.push_back( slot );
+                new_positions.push_back( position );
+            }
+        }
+    }
 
-    // At once the player position should be changed only by 1 chunk
-    assert(
-        std::abs( player_direction.x ) <= chunk_distance_diff &&
-        std::abs( player_direction.y ) <= chunk_distance_diff );
+    evictChunks( evicted_slots );
+
+    m_origin_pos = new_origin;
+    generateChunks( new_positions );
+} // ChunkMan::changeOriginPos
 
-    // Replace old chunks with new
-    if ( player_direction.y != 0 )
+void
+ChunkMan::loadOrGenerateChunk( Chunk& chunk )
+{
+    // Recently evicted chunks are in the memory, the saved ones are on the disk. Both are much cheaper
+    // to restore than to generate
+    if ( m_cache.take( chunk ) || ( m_storage && m_storage->loadChunk( chunk ) ) )
     {
-        auto old_chunks_y = 0;
-        auto new_chunks_y = 0;
+        return;
+    }
 
-        if ( player_direction.y > 0 )
-        {
-            // Old chunks that was "backward" in player render distance
-            // New chunks that "forward" in player render distance
-            old_chunks_y = m_origin_pos.y - k_render_distance;
-            new_chunks_y = m_origin_pos.y + k_render_distance + chunk_distance_diff;
-        } else
+    // Generated chunks are the same every time, only the edited ones are saved
+    simpleChunkGen( chunk );
+    chunk.setModified( false );
+} // ChunkMan::loadOrGenerateChunk
+
+void
+ChunkMan::evictChunks( std::span<const std::size_t> slots )
+{
+    JobSystem::getRef().parallelFor( slots.size(), [ this, slots ]( std::size_t index ) {
+        const auto slot = slots[ index ];
+        const auto state = m_states[ slot ].load( std::memory_order_acquire );
+        assert( state != ChunkState::k_empty && state != ChunkState::k_generating && state != ChunkState::k_meshing );
+
+        changeState( slot, state, ChunkState::k_evicting );
+
+        // The chunk is compressed once both for the disk and the cache
+        auto& chunk = m_chunks[ slot ];
+        auto data = compressChunk( chunk );
+
+        if ( m_storage && chunk.isModified() )
         {
-            // Old chunks that was "forward" in player render distance
-            // New chunks that "backward" in player render distance
-            old_chunks_y = m_origin_pos.y + k_render_distance;
-            new_chunks_y = m_origin_pos.y - k_render_distance - chunk_distance_diff;
+            m_storage->saveCompressedChunk( chunk.getPosition(), data );
+            chunk.setModified( false );
         }
 
-        auto min_x = m_origin_pos.x - k_render_distance;
-        auto max_x = m_origin_pos.x + k_render_distance;
+        m_cache.put( chunk.getPosition(), std::move( data ), chunk.isModified() );
 
-        for ( auto x = min_x; x <= max_x; x++ )
-        {
-            auto extracted_node = m_chunks.extract( pos::ChunkPos{ x, old_chunks_y } );
-            auto extracted_chunk = extracted_node.mapped();
-            extracted_node.key() = pos::ChunkPos{ x, new_chunks_y };
-            m_chunks.insert( std::move( extracted_node ) );
+        changeState( slot, ChunkState::k_evicting, ChunkState::k_empty );
+    } );
+} // ChunkMan::evictChunks
 
-            simpleChunkGen( extracted_chunk );
-        }
-    } else if ( player_direction.x != 0 )
+void
+ChunkMan::saveChunks()
+{
+    if ( !m_storage )
     {
-        auto old_chunks_x = 0;
-        auto new_chunks_x = 0;
+        return;
+    }
 
-        if ( player_direction.x > 0 )
-        {
-            // Old chunks that was "left" in player render distance
-            // New chunks that "right" in player render distance
-            old_chunks_x = m_origin_pos.x - k_render_distance;
-            new_chunks_x = m_origin_pos.x + k_render_distance + chunk_distance_diff;
-        } else
+    JobSystem::getRef().parallelFor( m_chunks.size(), [ this ]( std::size_t slot ) {
+        auto& chunk = m_chunks[ slot ];
+
+        if ( isGenerated( chunk.getPosition() ) && chunk.isModified() )
         {
-            // Old chunks that was "right" in player render distance
-            // New chunks that "left" in player render distance
-            old_chunks_x = m_origin_pos.x + k_render_distance;
-            new_chunks_x = m_origin_pos.x - k_render_distance - chunk_distance_diff;
+            m_storage->saveChunk( chunk );
+            chunk.setModified( false );
         }
+    } );
+} // ChunkMan::saveChunks
 
-        auto min_y = m_origin_pos.y - k_render_distance;
-        auto max_y = m_origin_pos.y + k_render_distance;
+bool
+ChunkMan::setBlock( const pos::BlockPos& block_pos, BlockID block_id )
+{
+    const auto chunk_pos = toChunkPos( block_pos );
 
-        for ( auto y = min_y; y <= max_y; y++ )
-        {
-            auto extracted_node = m_chunks.extract( pos::ChunkPos{ old_chunks_x, y } );
-            auto extracted_chunk = extracted_node.mapped();
-            extracted_node.key() = pos::ChunkPos{ new_chunks_x, y };
-            m_chunks.insert( std::move( extracted_node ) );
+    if ( !isGenerated( chunk_pos ) || block_pos.z < 0 || block_pos.z >= Chunk::k_max_height )
+    {
+        return false;
+    }
+
+    const auto x = block_pos.x - chunk_pos.x * Chunk::k_max_width_length;
+    const auto y = block_pos.y - chunk_pos.y * Chunk::k_max_width_length;
+
+    auto& chunk = getChunk( chunk_pos );
+    auto block = chunk.at( x, y, block_pos.z );
+
+    if ( block == block_id )
+    {
+        return true;
+    }
+
+    block = block_id;
+    markDirty( chunk_pos );
 
-            simpleChunkGen( extracted_chunk );
+    // Faces between the chunks depend on the blocks of both of them
+    constexpr auto k_last = Chunk::k_max_width_length - 1;
+
+    if ( x == 0 || x == k_last )
+    {
+        markDirty( chunk_pos + pos::ChunkPos{ x == 0 ? -1 : 1, 0 } );
+    }
+
+    if ( y == 0 || y == k_last )
+    {
+        markDirty( chunk_pos + pos::ChunkPos{ 0, y == 0 ? -1 : 1 } );
+    }
+
+    return true;
+} // ChunkMan::setBlock
+
+BlockID
+ChunkMan::getBlock( const pos::BlockPos& block_pos ) const
+{
+    const auto chunk_pos = toChunkPos( block_pos );
+
+    if ( !isGenerated( chunk_pos ) || block_pos.z < 0 || block_pos.z >= Chunk::k_max_height )
+    {
+        return BlockID::k_none;
+    }
+
+    return getChunk( chunk_pos ).at(
+        block_pos.x - chunk_pos.x * Chunk::k_max_width_length,
+        block_pos.y - chunk_pos.y * Chunk::k_max_width_length,
+        block_pos.z );
+} // ChunkMan::getBlock
+
+bool
+ChunkMan::isReadyForMeshing( const pos::ChunkPos& pos ) const
+{
+    if ( !isGenerated( pos ) )
+    {
+        return false;
+    }
+
+    // Neighbours out of the region are not drawn, so they are not waited for
+    const auto neighbours = getNeighbourPositions( pos );
+
+    return std::all_of( neighbours.begin(), neighbours.end(), [ this ]( const pos::ChunkPos& neighbour ) {
+        return !isInRegion( neighbour ) || isGenerated( neighbour );
+    } );
+} // ChunkMan::isReadyForMeshing
+
+std::size_t
+ChunkMan::getAllocatedBytesCount() const
+{
+    std::size_t bytes_count = 0;
+
+    for ( const auto& chunk : m_chunks )
+    {
+        bytes_count += chunk.getAllocatedBytesCount();
+    }
+
+    return bytes_count;
+} // ChunkMan::getAllocatedBytesCount
+
+ChunkMan::SectionsStats
+ChunkMan::getSectionsStats() const
+{
+    SectionsStats stats{};
+
+    for ( const auto& chunk : m_chunks )
+    {
+        for ( int section = 0; section < Chunk::k_sections_count; section++ )
+        {
+            switch ( chunk.getSectionState( section ) )
+            {
+            case Chunk::SectionState::k_absent:
+                stats.absent_count++;
+                break;
+            case Chunk::SectionState::k_uniform:
+                stats.uniform_count++;
+                break;
+            case Chunk::SectionState::k_dense:
+                stats.dense_count++;
+                break;
+            default:
+                assert( 0 && "Unknown section state" );
+            }
         }
     }
 
-    m_origin_pos = new_origin;
-} // ChunkMan::changeOriginPos
+    return stats;
+} // ChunkMan::getSectionsStats
 
 }; // namespace chunk
@@ -1,242 +1,954 @@
 #include "chunk/chunk_mesher.h"
+#include "chunk/face_masks.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <iterator>
+#include <utility>
 
 namespace chunk
 {
 
+namespace
+{
+
+/*
+ * Row of N * 64 bits, one bit per block of the row of the plane
+ */
+template <std::size_t N> struct BitRow
+{
+    std::array<uint64_t, N> words{};
+
+    friend BitRow operator&( const BitRow& lhs, const BitRow& rhs )
+    {
+        BitRow result;
+
+        for ( std::size_t word = 0; word < N; word++ )
+        {
+            result.words[ word ] = lhs.words[ word ] & rhs.words[ word ];
+        }
+
+        return result;
+    }
+
+    bool isEmpty() const
+    {
+        return std::all_of( words.begin(), words.end(), []( uint64_t word ) { return word == 0; } );
+    }
+
+    bool test( int bit ) const { return ( words[ bit / 64 ] >> ( bit % 64 ) ) & 1; }
+    void set( int bit ) { words[ bit / 64 ] |= uint64_t{ 1 } << ( bit % 64 ); }
+
+    // Index of the lowest set bit, the row shouldn't be empty
+    int findFirst() const
+    {
+        for ( std::size_t word = 0; word < N; word++ )
+        {
+            if ( words[ word ] != 0 )
+            {
+                return static_cast<int>( word * 64 ) + std::countr_zero( words[ word ] );
+            }
+        }
+
+        assert( false && "Row is empty" );
+        return 0;
+    }
+
+    // Number of the set bits in a row starting from the first one
+    int countOnes( int first ) const
+    {
+        int count = 0;
+
+        for ( std::size_t word = first / 64; word < N; word++ )
+        {
+            const auto shift = ( word == static_cast<std::size_t>( first / 64 ) ) ? first % 64 : 0;
+            const auto ones = std::countr_one( words[ word ] >> shift );
+
+            count += ones;
+            if ( ones < 64 - shift )
+            {
+                break;
+            }
+        }
+
+        return count;
+    }
+
+    // Bits [ first, first + count ) of the word
+    static uint64_t getMask( std::size_t word, int first, int count )
+    {
+        const auto word_begin = static_cast<int>( word * 64 );
+        const auto begin = std::clamp( first - word_begin, 0, 64 );
+        const auto end = std::clamp( first + count - word_begin, 0, 64 );
+
+        if ( begin == end )
+        {
+            return 0;
+        }
+
+        const auto high = ( end == 64 ) ? ~uint64_t{ 0 } : ( uint64_t{ 1 } << end ) - 1;
+        return high & ~( ( uint64_t{ 1 } << begin ) - 1 );
+    }
+
+    bool hasAll( int first, int count ) const
+    {
+        for ( std::size_t word = 0; word < N; word++ )
+        {
+            const auto mask = getMask( word, first, count );
+            if ( ( words[ word ] & mask ) != mask )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool hasNone( int first, int count ) const
+    {
+        for ( std::size_t word = 0; word < N; word++ )
+        {
+            if ( ( words[ word ] & getMask( word, first, count ) ) != 0 )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void clear( int first, int count )
+    {
+        for ( std::size_t word = 0; word < N; word++ )
+        {
+            words[ word ] &= ~getMask( word, first, count );
+        }
+    }
+}; // struct BitRow
+
+// Rows of the planes orthogonal to X and Z are 16 blocks wide, rows of the planes orthogonal to Y are columns
+using NarrowRow = BitRow<1>;
+using ColumnRow = BitRow<Chunk::k_max_height / 64>;
+
+// Scratch arrays start at the cache lines
+constexpr std::size_t k_scratch_alignment = 64;
+
+/*
+ * Axes of the sweep known at compile time: the planes are orthogonal to Dim and the faces lie
+ * in the plane OUV ( U = { Y, Z, X }, V = { Z, X, Y } for Dim = X, Y, Z )
+ */
+template <int Dim> struct FixedAxes
+{
+    static constexpr int dim = Dim;
+    static constexpr int u = ( Dim + 1 ) % 3;
+    static constexpr int v = ( Dim + 2 ) % 3;
+};
+
+// Axes of the sweep chosen at run time, like FixedAxes
+struct RuntimeAxes
+{
+    int dim;
+    int u;
+    int v;
+};
+
+// Plane of air, it's taken instead of the planes of the neighbours that the chunk doesn't have
+const std::array<BlockID, Chunk::k_max_slice_size> k_air_slice = [] {
+    std::array<BlockID, Chunk::k_max_slice_size> slice{};
+    slice.fill( BlockID::k_none );
+    return slice;
+}();
+
+}; // namespace
+
+struct ChunkMesher::MesherContext::Scratch
+{
+    // unpacked block ides of the chunk being meshed
+    alignas( k_scratch_alignment ) std::array<BlockID, Chunk::k_block_count> chunk_blocks;
+
+    alignas( k_scratch_alignment ) NeighbourSides neighbour_sides;
+
+    // greedyMesh(): the current and the next plane and the maps of the faces between them
+    alignas( k_scratch_alignment ) std::array<std::array<BlockID, Chunk::k_max_slice_size>, 2> slices;
+    alignas( k_scratch_alignment ) std::array<bool, Chunk::k_max_slice_size> cmp_map;
+    alignas( k_scratch_alignment ) std::array<bool, Chunk::k_max_slice_size> normal_map;
+    alignas( k_scratch_alignment ) std::array<BlockID, Chunk::k_max_slice_size> face_map;
+
+    // binaryMesh(): bitmasks of the chunk and of the planes of the neighbours
+    alignas( k_scratch_alignment ) std::array<NarrowRow, Chunk::k_max_width_length * Chunk::k_max_height> rows_x;
+    alignas( k_scratch_alignment ) std::array<ColumnRow, Chunk::k_columns_count> rows_y;
+    alignas( k_scratch_alignment ) std::array<NarrowRow, Chunk::k_max_height * Chunk::k_max_width_length> rows_z;
+    alignas( k_scratch_alignment ) std::array<std::array<NarrowRow, Chunk::k_max_height>, 2> side_rows_x;
+    alignas( k_scratch_alignment ) std::array<std::array<ColumnRow, Chunk::k_max_width_length>, 2> side_rows_y;
+
+    // grows to the biggest mesh and keeps its capacity for the next chunks
+    Faces faces;
+}; // struct ChunkMesher::MesherContext::Scratch
+
+ChunkMesher::MesherContext::MesherContext()
+    : m_scratch( std::make_unique<Scratch>() )
+{
+} /* ChunkMesher::MesherContext::MesherContext */
+
+ChunkMesher::MesherContext::MesherContext( MesherContext&& ) noexcept = default;
+ChunkMesher::MesherContext& ChunkMesher::MesherContext::operator=( MesherContext&& ) noexcept = default;
+ChunkMesher::MesherContext::~MesherContext() = default;
+
 void
-ChunkMesher::addFace( const auto& face_info )
+ChunkMesher::addFace( Faces& faces, std::size_t direction, const auto& face_info )
 {
-    const auto vertex_count = static_cast<uint32_t>( m_vertices.size() );
+    auto& vertices = faces.vertices;
+    auto& indices = faces.indices[ direction ];
 
-    m_vertices.emplace_back( face_info.v1, face_info.block_id, 0, 0 );
-    m_vertices.emplace_back( face_info.v2, face_info.block_id, face_info.width, 0 );
-    m_vertices.emplace_back( face_info.v3, face_info.block_id, 0, face_info.height );
-    m_vertices.emplace_back( face_info.v4, face_info.block_id, face_info.width, face_info.height );
+    const auto vertex_count = static_cast<uint32_t>( vertices.size() );
+
+    vertices.emplace_back( face_info.v1, face_info.block_id, 0, 0 );
+    vertices.emplace_back( face_info.v2, face_info.block_id, face_info.width, 0 );
+    vertices.emplace_back( face_info.v3, face_info.block_id, 0, face_info.height );
+    vertices.emplace_back( face_info.v4, face_info.block_id, face_info.width, face_info.height );
 
     // [krisszzzz]
     // change vertices order to backward ( from clockwise to counter-clockwise ) if
     // it is not a front face
     if ( face_info.is_front_face )
     {
-        m_indices.push_back( vertex_count + 0 );
-        m_indices.push_back( vertex_count + 1 );
-        m_indices.push_back( vertex_count + 2 );
-        m_indices.push_back( vertex_count + 1 );
-        m_indices.push_back( vertex_count + 3 );
-        m_indices.push_back( vertex_count + 2 );
+        indices.push_back( vertex_count + 0 );
+        indices.push_back( vertex_count + 1 );
+        indices.push_back( vertex_count + 2 );
+        indices.push_back( vertex_count + 1 );
+        indices.push_back( vertex_count + 3 );
+        indices.push_back( vertex_count + 2 );
     } else
     {
-        m_indices.push_back( vertex_count + 2 );
-        m_indices.push_back( vertex_count + 3 );
-        m_indices.push_back( vertex_count + 1 );
-        m_indices.push_back( vertex_count + 2 );
-        m_indices.push_back( vertex_count + 1 );
-        m_indices.push_back( vertex_count + 0 );
+        indices.push_back( vertex_count + 2 );
+        indices.push_back( vertex_count + 3 );
+        indices.push_back( vertex_count + 1 );
+        indices.push_back( vertex_count + 2 );
+        indices.push_back( vertex_count + 1 );
+        indices.push_back( vertex_count + 0 );
     }
 } /* ChunkMesher::addFace */
 
 auto
-ChunkMesher::toRenderAreaBlockPos( uint16_t x, uint16_t y, uint16_t z, const pos::ChunkPos& chunk_pos ) const
+ChunkMesher::toLocalBlockPos( uint16_t x, uint16_t y, uint16_t z )
+{
+    return LocalBlockPos{ x, y, z };
+} /* ChunkMesher::toLocalBlockPos */
+
+void
+ChunkMesher::addQuad(
+    Faces& faces,
+    auto axes,
+    const std::array<int, 3>& corner,
+    int width,
+    int height,
+    bool is_front_face,
+    BlockID block_id )
 {
-    return RenderAreaBlockPos{
-        static_cast<uint16_t>( ( chunk_pos.x - m_render_area_right.x ) * chunk::Chunk::k_max_width_length + x ),
-        static_cast<uint16_t>( ( chunk_pos.y - m_render_area_right.y ) * chunk::Chunk::k_max_width_length + y ),
-        z };
-} /* ChunkMesher::toRenderAreaBlockPos */
+    constexpr int x = 0;
+    constexpr int y = 1;
+    constexpr int z = 2;
+
+    const auto direction = static_cast<std::size_t>( 2 * axes.dim + ( is_front_face ? 1 : 0 ) );
+
+    // the rest of the vertices are made by the vertex shader
+    if ( s_mesh_format == MeshFormat::k_quads )
+    {
+        const auto position = QuadPos{
+            static_cast<uint32_t>( corner[ x ] ),
+            static_cast<uint32_t>( corner[ y ] ),
+            static_cast<uint32_t>( corner[ z ] ),
+            static_cast<uint32_t>( axes.dim ),
+            is_front_face };
+
+        faces.quads[ direction ].emplace_back( position, block_id, width, height );
+        return;
+    }
+
+    std::array<int, 3> du{};
+    std::array<int, 3> dv{};
+
+    du[ axes.u ] = width;
+    dv[ axes.v ] = height;
+
+    const FaceInfo face_info{
+        .is_front_face = is_front_face,
+        .block_id = block_id,
+        .width = width,
+        .height = height,
+        .v1 = toLocalBlockPos( corner[ x ], corner[ y ], corner[ z ] ),
+        .v2 = toLocalBlockPos( corner[ x ] + du[ x ], corner[ y ] + du[ y ], corner[ z ] + du[ z ] ),
+        .v3 = toLocalBlockPos( corner[ x ] + dv[ x ], corner[ y ] + dv[ y ], corner[ z ] + dv[ z ] ),
+        .v4 = toLocalBlockPos(
+            corner[ x ] + du[ x ] + dv[ x ],
+            corner[ y ] + du[ y ] + dv[ y ],
+            corner[ z ] + du[ z ] + dv[ z ] ) };
+
+    addFace( faces, direction, face_info );
+} /* ChunkMesher::addQuad */
 
 void
-ChunkMesher::meshRenderArea()
+ChunkMesher::decodeOccupiedSections( const Chunk& chunk, std::span<BlockID, Chunk::k_block_count> blocks )
 {
+    const auto heights = chunk.getHeightRange();
 
+    if ( heights.begin == heights.end )
+    {
+        return;
+    }
+
+    const auto first_section = heights.begin / Chunk::k_section_height;
+    const auto last_section = ( heights.end - 1 ) / Chunk::k_section_height;
+
+    for ( int section = first_section; section <= last_section; section++ )
+    {
+        auto section_blocks = blocks.subspan( section * Chunk::k_section_block_count );
+        chunk.decodeSection( section, section_blocks.first<Chunk::k_section_block_count>() );
+    }
+} /* ChunkMesher::decodeOccupiedSections */
+
+void
+ChunkMesher::readNeighbourSides( const pos::ChunkPos& chunk_pos, int z_begin, int z_end, NeighbourSides& sides )
+{
     auto&& chunk_man = ChunkMan::getRef();
-    m_render_area_right =
-        chunk_man.getOriginPos() - pos::ChunkPos{ chunk_man.k_render_distance, chunk_man.k_render_distance };
 
-    for ( int x = -chunk_man.k_render_distance; x <= chunk_man.k_render_distance; x++ )
+    constexpr int k_last = Chunk::k_max_width_length - 1;
+
+    const auto neighbours = ChunkMan::getNeighbourPositions( chunk_pos );
+
+    for ( std::size_t side = 0; side < neighbours.size(); side++ )
     {
-        for ( int y = -chunk_man.k_render_distance; y <= chunk_man.k_render_distance; y++ )
+        const auto& neighbour_pos = neighbours[ side ];
+
+        // neighbours along X touch the chunk by their planes orthogonal to X, the lower one by its last plane
+        const auto axis = static_cast<int>( side / 2 );
+        const auto coord = ( side % 2 == 0 ) ? k_last : 0;
+
+        // Chunk is meshed only when its neighbours in the region are generated ( see ChunkMan::isReadyForMeshing() )
+        if ( !chunk_man.isGenerated( neighbour_pos ) )
         {
-            auto&& chunk = chunk_man.getChunk( { x, y } );
+            sides[ side ].fill( BlockID::k_none );
+            continue;
+        }
+
+        chunk_man.getChunk( neighbour_pos ).readSlice( axis, coord, z_begin, z_end, sides[ side ] );
+    }
+} /* ChunkMesher::readNeighbourSides */
+
+ChunkMesher::ChunkMesh
+ChunkMesher::meshChunk( const pos::ChunkPos& chunk_pos, MesherContext& context )
+{
+    auto&& chunk_man = ChunkMan::getRef();
+    const auto& chunk = chunk_man.getChunk( chunk_pos );
+    const auto heights = chunk.getHeightRange();
+
+    // blocks of the neighbours hide the faces at the sides of the chunk
+    auto& scratch = *context.m_scratch;
+    readNeighbourSides( chunk_pos, heights.begin, heights.end, scratch.neighbour_sides );
+
+    switch ( s_meshing_mode )
+    {
+    case MeshingMode::k_greedy:
+        greedyMesh( chunk, scratch.neighbour_sides, context );
+        break;
+    case MeshingMode::k_greedy_fixed_axes:
+        greedyMeshFixedAxes( chunk, scratch.neighbour_sides, context );
+        break;
+    default:
+        binaryMesh( chunk, scratch.neighbour_sides, context );
+    }
+
+    const auto min_x = chunk_pos.x * Chunk::k_max_width_length;
+    const auto min_y = chunk_pos.y * Chunk::k_max_width_length;
+
+    const auto neighbours = ChunkMan::getNeighbourPositions( chunk_pos );
+
+    std::array<bool, 4> is_side_closed{};
+    std::transform( neighbours.begin(), neighbours.end(), is_side_closed.begin(), [ &chunk_man ]( const auto& pos ) {
+        return !chunk_man.isGenerated( pos );
+    } );
+
+    auto mesh = ChunkMesh{
+        .position = chunk_pos,
+        .vertices = { scratch.faces.vertices.begin(), scratch.faces.vertices.end() },
+        .indices = {},
+        .wide_indices = {},
+        .quads = {},
+        .bounds = Bounds{
+            .min = pos::BlockPos{ .x = min_x, .y = min_y, .z = heights.begin },
+            .max = pos::BlockPos{
+                .x = min_x + Chunk::k_max_width_length,
+                .y = min_y + Chunk::k_max_width_length,
+                .z = heights.end } },
+        .is_side_closed = is_side_closed,
+        .face_ranges = {} };
+
+    // only one of the formats is filled, the faces of the directions are put one after another
+    std::size_t indices_count = 0;
+    std::size_t quads_count = 0;
+
+    for ( std::size_t direction = 0; direction < k_directions_count; direction++ )
+    {
+        indices_count += scratch.faces.indices[ direction ].size();
+        quads_count += scratch.faces.quads[ direction ].size();
+    }
 
-            greedyMesh( { x, y }, chunk );
+    // indices are narrowed to 16 bits, unless some of the vertices can't be addressed by them
+    const bool is_wide = ( mesh.vertices.size() > k_max_short_indexed_vertices );
+
+    mesh.indices.reserve( is_wide ? 0 : indices_count );
+    mesh.wide_indices.reserve( is_wide ? indices_count : 0 );
+    mesh.quads.reserve( quads_count );
+
+    for ( std::size_t direction = 0; direction < k_directions_count; direction++ )
+    {
+        const auto& indices = scratch.faces.indices[ direction ];
+        const auto& quads = scratch.faces.quads[ direction ];
+
+        mesh.face_ranges[ direction ] = FaceRange{
+            .first = static_cast<uint32_t>( mesh.getIndicesCount() + mesh.quads.size() ),
+            .count = static_cast<uint32_t>( indices.size() + quads.size() ) };
+
+        if ( is_wide )
+        {
+            mesh.wide_indices.insert( mesh.wide_indices.end(), indices.begin(), indices.end() );
+        } else
+        {
+            std::transform( indices.begin(), indices.end(), std::back_inserter( mesh.indices ), []( uint32_t index ) {
+                return static_cast<uint16_t>( index );
+            } );
         }
+
+        mesh.quads.insert( mesh.quads.end(), quads.begin(), quads.end() );
     }
-} /* ChunkMesher::meshRenderArea */
+
+    return mesh;
+} /* ChunkMesher::meshChunk */
+
+bool
+ChunkMesher::Bounds::isFacing( std::size_t direction, float x, float y, float z ) const
+{
+    assert( direction < k_directions_count );
+
+    const auto dim = direction / 2;
+    const bool is_front_face = ( direction % 2 == 1 );
+
+    const std::array<float, 3> point{ x, y, z };
+    const std::array<float, 3> lowest{
+        static_cast<float>( min.x ),
+        static_cast<float>( min.y ),
+        static_cast<float>( min.z ) };
+    const std::array<float, 3> highest{
+        static_cast<float>( max.x ),
+        static_cast<float>( max.y ),
+        static_cast<float>( max.z ) };
+
+    // the front faces look to +dim, none of them lies below the min plane of the bounds
+    return is_front_face ? ( point[ dim ] > lowest[ dim ] ) : ( point[ dim ] < highest[ dim ] );
+} /* ChunkMesher::Bounds::isFacing */
 
 void
-ChunkMesher::greedyMesh( const pos::ChunkPos& chunk_pos, const Chunk& chunk )
+ChunkMesher::greedyMesh( const Chunk& chunk, const NeighbourSides& neighbour_sides, MesherContext& context )
 {
-    // Sweep over each Axis ( X, Y, Z )
-    for ( size_t dim = 0; dim < 3; dim++ )
+    greedyMeshAxes(
+        chunk,
+        neighbour_sides,
+        context,
+        RuntimeAxes{ 0, 1, 2 },
+        RuntimeAxes{ 1, 2, 0 },
+        RuntimeAxes{ 2, 0, 1 } );
+} /* ChunkMesher::greedyMesh */
+
+void
+ChunkMesher::greedyMeshFixedAxes( const Chunk& chunk, const NeighbourSides& neighbour_sides, MesherContext& context )
+{
+    // Every sweep is compiled for its axis, so the limits and the strides of the planes are constants
+    greedyMeshAxes( chunk, neighbour_sides, context, FixedAxes<0>{}, FixedAxes<1>{}, FixedAxes<2>{} );
+} /* ChunkMesher::greedyMeshFixedAxes */
+
+void
+ChunkMesher::greedyMeshAxes(
+    const Chunk& chunk,
+    const NeighbourSides& neighbour_sides,
+    MesherContext& context,
+    auto... sweep_axes )
+{
+    auto& scratch = *context.m_scratch;
+
+    scratch.faces.clear();
+
+    const auto heights = chunk.getHeightRange();
+
+    // chunk contains only air
+    if ( heights.begin == heights.end )
     {
-        constexpr int x = 0;
-        constexpr int y = 1;
-        constexpr int z = 2;
-        constexpr int dim_count = 3;
+        return;
+    }
 
-        // width and height of cuboid
-        int width = 0;
-        int height = 0;
+    // the palette is decoded only once per chunk. Only the sections with the blocks between the lowest
+    // and the highest ones are decoded, the rest are never read
+    decodeOccupiedSections( chunk, scratch.chunk_blocks );
 
-        // work with plane OUV ( U = { Y, Z, X }, V = { Z, X, Y } )
-        const size_t u = ( dim + 1 ) % dim_count;
-        const size_t v = ( dim + 2 ) % dim_count;
+    // Planes between two blocks of the same absent or uniform section have no faces
+    std::array<bool, Chunk::k_sections_count> is_flat_section{};
+    for ( int section = 0; section < Chunk::k_sections_count; section++ )
+    {
+        is_flat_section[ section ] = ( chunk.getSectionState( section ) != Chunk::SectionState::k_dense );
+    }
 
-        // axis array
-        std::array<int, 3> axis{};
-        // direction array
-        std::array<int, 3> dir{};
-
-        // comparison map show the result of comparison block with the next block
-        // with choosen direction
-        static std::array<bool, Chunk::k_max_width_length * Chunk::k_max_height> cmp_map{};
-        // normal map show the orientation of face ( back or front )
-        static std::array<bool, Chunk::k_max_width_length * Chunk::k_max_height> normal_map{};
-        // save the face of the block to draw
-        static std::array<BlockID, Chunk::k_max_width_length * Chunk::k_max_height> face_map{};
-
-        // define direction of comparison
-        dir[ dim ] = 1;
-
-        // limitation of iteration on the axis normal to the plane of OUV
-        const int dir_limits = ( dim == z ) ? Chunk::k_max_height : Chunk::k_max_width_length;
-        // U and V limitations
-        const int u_limits = ( u == z ) ? Chunk::k_max_height : Chunk::k_max_width_length;
-        const int v_limits = ( v == z ) ? Chunk::k_max_height : Chunk::k_max_width_length;
-        // slice chunk with plane OUV
-        for ( axis[ dim ] = -1; axis[ dim ] < dir_limits; )
-        {
-            size_t block_index = 0;
-
-            for ( axis[ v ] = 0; axis[ v ] < v_limits; axis[ v ]++ )
-            {
-                for ( axis[ u ] = 0; axis[ u ] < u_limits; axis[ u ]++ )
-                {
-                    auto at_xyz = ( axis[ dim ] >= 0 ) ? chunk.at( axis[ x ], axis[ y ], axis[ z ] ) : BlockID::k_none;
-                    auto at_xyz_dir = ( axis[ dim ] < dir_limits - 1 )
-                        ? chunk.at( axis[ x ] + dir[ x ], axis[ y ] + dir[ y ], axis[ z ] + dir[ z ] )
-                        : BlockID::k_none;
+    // Sweep over each Axis ( X, Y, Z )
+    ( greedySweep( chunk, neighbour_sides, context, is_flat_section, sweep_axes ), ... );
+} /* ChunkMesher::greedyMeshAxes */
 
-                    const bool block_current = ( at_xyz == BlockID::k_none );
-                    const bool block_compare = ( at_xyz_dir == BlockID::k_none );
+void
+ChunkMesher::greedySweep(
+    const Chunk& chunk,
+    const NeighbourSides& neighbour_sides,
+    MesherContext& context,
+    const std::array<bool, Chunk::k_sections_count>& is_flat_section,
+    auto axes )
+{
+    constexpr int z = 2;
+    constexpr int k_no_slice = -1;
+
+    auto& scratch = *context.m_scratch;
+    const auto& chunk_blocks = scratch.chunk_blocks;
+
+    // work with plane OUV ( U = { Y, Z, X }, V = { Z, X, Y } ). For the fixed axes these are constants,
+    // and so are the limits and the strides below
+    const int dim = axes.dim;
+    const int u = axes.u;
+    const int v = axes.v;
+
+    // Blocks below the lowest and above the highest non-air block are air, so there are no faces to look for.
+    // Limits are in order ( X, Y, Z )
+    const auto heights = chunk.getHeightRange();
+    const std::array<int, 3> lower_limits{ 0, 0, heights.begin };
+    const std::array<int, 3> upper_limits{ Chunk::k_max_width_length, Chunk::k_max_width_length, heights.end };
+
+    // width and height of cuboid
+    int width = 0;
+    int height = 0;
+
+    // axis array
+    std::array<int, 3> axis{};
+
+    // planes of the chunk at the current coordinate and the next one along the axis. Each plane is extracted
+    // once and reused as the current one on the next step
+    BlockID* current_slice = scratch.slices[ 0 ].data();
+    BlockID* next_slice = scratch.slices[ 1 ].data();
+    int current_coord = k_no_slice;
+    int next_coord = k_no_slice;
+
+    // planes are indexed as v * slice_width + u
+    const int slice_width = ( u == z ) ? Chunk::k_max_height : Chunk::k_max_width_length;
+
+    // planes of the neighbours before the first and after the last plane of the chunk, chunk has no neighbours
+    // along Z
+    const BlockID* lower_side = ( dim == z ) ? k_air_slice.data() : neighbour_sides[ 2 * dim ].data();
+    const BlockID* upper_side = ( dim == z ) ? k_air_slice.data() : neighbour_sides[ 2 * dim + 1 ].data();
+
+    auto extract_slice = [ & ]( int coord, BlockID* slice ) {
+        Chunk::extractSlice(
+            chunk_blocks,
+            dim,
+            coord,
+            lower_limits[ z ],
+            upper_limits[ z ],
+            std::span<BlockID, Chunk::k_max_slice_size>{ slice, Chunk::k_max_slice_size } );
+    };
+
+    // comparison map show the result of comparison block with the next block
+    // with choosen direction
+    auto& cmp_map = scratch.cmp_map;
+    // normal map show the orientation of face ( back or front )
+    auto& normal_map = scratch.normal_map;
+    // save the face of the block to draw
+    auto& face_map = scratch.face_map;
+
+    // limitation of iteration on the axis normal to the plane of OUV
+    const int dir_limits = ( dim == z ) ? Chunk::k_max_height : Chunk::k_max_width_length;
+    // U and V limitations, maps are indexed relative to the lower limits
+    const int u_begin = lower_limits[ u ];
+    const int v_begin = lower_limits[ v ];
+    const int u_limits = upper_limits[ u ] - u_begin;
+    const int v_limits = upper_limits[ v ] - v_begin;
+    // slice chunk with plane OUV
+    for ( axis[ dim ] = lower_limits[ dim ] - 1; axis[ dim ] < upper_limits[ dim ]; )
+    {
+        if ( dim == z && axis[ z ] >= 0 && axis[ z ] < dir_limits - 1 &&
+             axis[ z ] / Chunk::k_section_height == ( axis[ z ] + 1 ) / Chunk::k_section_height &&
+             is_flat_section[ axis[ z ] / Chunk::k_section_height ] )
+        {
+            axis[ dim ]++;
+            continue;
+        }
 
-                    cmp_map[ block_index ] = ( block_current != block_compare );
-                    face_map[ block_index ] = block_compare ? at_xyz : at_xyz_dir;
-                    normal_map[ block_index ] = block_compare;
+        // blocks out of the limits are air, they are not even decoded
+        const bool has_current = ( axis[ dim ] >= lower_limits[ dim ] );
+        const bool has_next = ( axis[ dim ] + 1 < upper_limits[ dim ] );
 
-                    block_index++;
-                }
+        if ( has_current && current_coord != axis[ dim ] )
+        {
+            if ( next_coord == axis[ dim ] )
+            {
+                std::swap( current_slice, next_slice );
+                std::swap( current_coord, next_coord );
+            } else
+            {
+                extract_slice( axis[ dim ], current_slice );
+                current_coord = axis[ dim ];
             }
+        }
 
-            block_index = 0;
-            axis[ dim ]++;
+        if ( has_next && next_coord != axis[ dim ] + 1 )
+        {
+            extract_slice( axis[ dim ] + 1, next_slice );
+            next_coord = axis[ dim ] + 1;
+        }
 
+        // neighbour planes are taken out of the limits of the chunk
+        const BlockID* current_plane = has_current ? current_slice : lower_side;
+        const BlockID* next_plane = has_next ? next_slice : upper_side;
+
+        // the face of the neighbour block is made by the neighbour chunk
+        const bool is_lower_side = !has_current;
+        const bool is_upper_side = !has_next;
+
+        // maps of the rows are built by the SIMD kernels ( see buildFaceMasks() ). Rows of the planes
+        // orthogonal to X and Z are whole, so such planes are handled at once
+        auto build_rows = [ & ]( int first_row, int rows_count ) {
+            const auto plane_offset = ( v_begin + first_row ) * slice_width + u_begin;
+            const auto map_offset = static_cast<std::size_t>( first_row * u_limits );
+            const auto size = static_cast<std::size_t>( rows_count * u_limits );
+
+            buildFaceMasks(
+                { current_plane + plane_offset, size },
+                { next_plane + plane_offset, size },
+                is_lower_side,
+                is_upper_side,
+                FaceMasks{
+                    .cmp = std::span{ cmp_map }.subspan( map_offset, size ),
+                    .normal = std::span{ normal_map }.subspan( map_offset, size ),
+                    .face = std::span{ face_map }.subspan( map_offset, size ) } );
+        };
+
+        if ( u_limits == slice_width )
+        {
+            build_rows( 0, v_limits );
+        } else
+        {
             for ( int j = 0; j < v_limits; j++ )
             {
-                for ( int i = 0; i < u_limits; )
+                build_rows( j, 1 );
+            }
+        }
+
+        size_t block_index = 0;
+        axis[ dim ]++;
+
+        for ( int j = 0; j < v_limits; j++ )
+        {
+            for ( int i = 0; i < u_limits; )
+            {
+                const bool mask = cmp_map[ block_index ];
+                const bool orientation = normal_map[ block_index ];
+                auto face_id = face_map[ block_index ];
+
+                if ( !mask )
                 {
-                    const bool mask = cmp_map[ block_index ];
-                    const bool orientation = normal_map[ block_index ];
-                    auto face_id = face_map[ block_index ];
+                    block_index++;
+                    i++;
 
-                    if ( !mask )
-                    {
-                        block_index++;
-                        i++;
+                    continue;
+                }
 
-                        continue;
+                for ( width = 1; i + width < u_limits; width++ )
+                {
+                    if ( !cmp_map[ block_index + width ] || //
+                         face_id != face_map[ block_index + width ] ||
+                         orientation != normal_map[ block_index + width ] )
+                    {
+                        break;
                     }
+                }
 
-                    for ( width = 1; i + width < u_limits; width++ )
+                bool done = false;
+
+                for ( height = 1; j + height < v_limits; height++ )
+                {
+                    for ( int k = 0; k < width; k++ )
                     {
-                        if ( !cmp_map[ block_index + width ] || //
-                             face_id != face_map[ block_index + width ] ||
-                             orientation != normal_map[ block_index + width ] )
+                        if ( !cmp_map[ block_index + k + height * u_limits ] ||
+                             face_id != face_map[ block_index + k + height * u_limits ] ||
+                             orientation != normal_map[ block_index + k + height * u_limits ] )
                         {
+                            done = true;
                             break;
                         }
                     }
 
-                    bool done = false;
+                    if ( done )
+                    {
+                        break;
+                    }
+                }
+
+                axis[ u ] = u_begin + i;
+                axis[ v ] = v_begin + j;
+
+                addQuad( scratch.faces, axes, axis, width, height, normal_map[ block_index ], face_map[ block_index ] );
+
+                // clear map
+                for ( int l = 0; l < height; l++ )
+                {
+                    for ( int k = 0; k < width; k++ )
+                    {
+                        cmp_map[ block_index + k + l * u_limits ] = false;
+                    }
+                }
+
+                i += width;
+                block_index += width;
+            }
+        }
+    }
+} /* ChunkMesher::greedySweep */
+
+void
+ChunkMesher::binaryMesh( const Chunk& chunk, const NeighbourSides& neighbour_sides, MesherContext& context )
+{
+    auto& scratch = *context.m_scratch;
+    auto& chunk_blocks = scratch.chunk_blocks;
+
+    scratch.faces.clear();
+
+    const auto heights = chunk.getHeightRange();
+
+    // chunk contains only air
+    if ( heights.begin == heights.end )
+    {
+        return;
+    }
+
+    decodeOccupiedSections( chunk, chunk_blocks );
+
+    // Bitmasks of non-air blocks, one row for every row of the planes orthogonal to the axes.
+    // Planes orthogonal to X: [ x * k_max_height + z ], bit y. Planes orthogonal to Y: [ x * k_max_width_length + y ],
+    // bit z, these are the columns of the chunk. Planes orthogonal to Z: [ z * k_max_width_length + y ], bit x
+    auto& rows_x = scratch.rows_x;
+    auto& rows_y = scratch.rows_y;
+    auto& rows_z = scratch.rows_z;
+
+    rows_x.fill( NarrowRow{} );
+    rows_y.fill( ColumnRow{} );
+    std::fill_n( rows_z.begin() + heights.begin * Chunk::k_max_width_length,
+                 ( heights.end - heights.begin ) * Chunk::k_max_width_length,
+                 NarrowRow{} );
+
+    for ( int x = 0; x < Chunk::k_max_width_length; x++ )
+    {
+        for ( int y = 0; y < Chunk::k_max_width_length; y++ )
+        {
+            for ( int z = heights.begin; z < heights.end; z++ )
+            {
+                if ( chunk_blocks[ Chunk::toIndex( x, y, z ) ] != BlockID::k_none )
+                {
+                    rows_x[ x * Chunk::k_max_height + z ].set( y );
+                    rows_y[ x * Chunk::k_max_width_length + y ].set( z );
+                    rows_z[ z * Chunk::k_max_width_length + y ].set( x );
+                }
+            }
+        }
+    }
+
+    // Bitmasks of the planes of the neighbours touching the sides ( lower and upper ) of the chunk
+    auto& side_rows_x = scratch.side_rows_x;
+    auto& side_rows_y = scratch.side_rows_y;
+
+    for ( int side = 0; side < 2; side++ )
+    {
+        side_rows_x[ side ].fill( NarrowRow{} );
+        side_rows_y[ side ].fill( ColumnRow{} );
+
+        for ( int z = heights.begin; z < heights.end; z++ )
+        {
+            for ( int u = 0; u < Chunk::k_max_width_length; u++ )
+            {
+                if ( neighbour_sides[ side ][ z * Chunk::k_max_width_length + u ] != BlockID::k_none )
+                {
+                    side_rows_x[ side ][ z ].set( u );
+                }
+
+                if ( neighbour_sides[ 2 + side ][ u * Chunk::k_max_height + z ] != BlockID::k_none )
+                {
+                    side_rows_y[ side ][ u ].set( z );
+                }
+            }
+        }
+    }
+
+    // Limits of the blocks in order ( X, Y, Z ), blocks out of them are air
+    const std::array<int, 3> lower_limits{ 0, 0, heights.begin };
+    const std::array<int, 3> upper_limits{ Chunk::k_max_width_length, Chunk::k_max_width_length, heights.end };
+
+    // Mesh the planes between the layers of blocks orthogonal to the axis dim. The row at ( layer, v ) is
+    // given by get_row and the row of the neighbour at the lower ( 0 ) or upper ( 1 ) side is given by get_side_row.
+    // Faces are merged in the same order as greedyMesh() does, so the result is the same
+    auto mesh_axis = [ & ]( auto axes, auto get_row, auto get_side_row ) {
+        using Row = decltype( get_row( 0, 0 ) );
+
+        const int dim = axes.dim;
+        const int u = axes.u;
+        const int v = axes.v;
+
+        // faces between the layers and the front ones of them ( non-air block is followed by air )
+        std::array<Row, Chunk::k_max_height> faces{};
+        std::array<Row, Chunk::k_max_height> fronts{};
+
+        std::array<int, 3> axis{};
+
+        // face at ( u, v ) shows the block before the plane, if it's the front one, and the block after it otherwise
+        auto get_face_id = [ & ]( int face_u, int face_v, bool is_front_face ) {
+            std::array<int, 3> block = axis;
+            block[ u ] = face_u;
+            block[ v ] = face_v;
+            block[ dim ] -= is_front_face ? 1 : 0;
+
+            return chunk_blocks[ Chunk::toIndex( block[ 0 ], block[ 1 ], block[ 2 ] ) ];
+        };
+
+        for ( int layer = lower_limits[ dim ] - 1; layer < upper_limits[ dim ]; layer++ )
+        {
+            const bool has_current = ( layer >= lower_limits[ dim ] );
+            const bool has_next = ( layer + 1 < upper_limits[ dim ] );
+
+            bool has_faces = false;
+
+            for ( int row = lower_limits[ v ]; row < upper_limits[ v ]; row++ )
+            {
+                auto current = has_current ? get_row( layer, row ) : Row{};
+                auto next = has_next ? get_row( layer + 1, row ) : Row{};
+
+                // non-air blocks of the neighbours hide the faces of the chunk, but their own faces are made
+                // by the neighbours
+                if ( !has_current )
+                {
+                    current = get_side_row( 0, row ) & next;
+                }
+
+                if ( !has_next )
+                {
+                    next = get_side_row( 1, row ) & current;
+                }
+
+                for ( std::size_t word = 0; word < current.words.size(); word++ )
+                {
+                    faces[ row ].words[ word ] = current.words[ word ] ^ next.words[ word ];
+                    fronts[ row ].words[ word ] = current.words[ word ] & ~next.words[ word ];
+                }
+
+                has_faces = has_faces || !faces[ row ].isEmpty();
+            }
+
+            if ( !has_faces )
+            {
+                continue;
+            }
+
+            // faces lie in the plane after the current layer
+            axis[ dim ] = layer + 1;
+
+            for ( int row = lower_limits[ v ]; row < upper_limits[ v ]; row++ )
+            {
+                while ( !faces[ row ].isEmpty() )
+                {
+                    const auto first = faces[ row ].findFirst();
+                    const bool is_front_face = fronts[ row ].test( first );
+                    const auto face_id = get_face_id( first, row, is_front_face );
+
+                    // faces of the same block and orientation are merged, the rest of the run is left for later
+                    const auto run_length = faces[ row ].countOnes( first );
+                    int width = 1;
+
+                    while ( width < run_length && fronts[ row ].test( first + width ) == is_front_face &&
+                            get_face_id( first + width, row, is_front_face ) == face_id )
+                    {
+                        width++;
+                    }
+
+                    int height = 1;
 
-                    for ( height = 1; j + height < v_limits; height++ )
+                    for ( ; row + height < upper_limits[ v ]; height++ )
                     {
-                        for ( int k = 0; k < width; k++ )
+                        const auto& next_faces = faces[ row + height ];
+                        const auto& next_fronts = fronts[ row + height ];
+
+                        const bool is_same_orientation = is_front_face ? next_fronts.hasAll( first, width )
+                                                                       : next_fronts.hasNone( first, width );
+
+                        if ( !next_faces.hasAll( first, width ) || !is_same_orientation )
                         {
-                            if ( !cmp_map[ block_index + k + height * u_limits ] ||
-                                 face_id != face_map[ block_index + k + height * u_limits ] ||
-                                 orientation != normal_map[ block_index + k + height * u_limits ] )
-                            {
-                                done = true;
-                                break;
-                            }
+                            break;
                         }
 
-                        if ( done )
+                        bool is_same_block = true;
+                        for ( int k = 0; k < width && is_same_block; k++ )
+                        {
+                            is_same_block = ( get_face_id( first + k, row + height, is_front_face ) == face_id );
+                        }
+
+                        if ( !is_same_block )
                         {
                             break;
                         }
                     }
 
-                    axis[ u ] = i;
-                    axis[ v ] = j;
-
-                    std::array<int, 3> du{};
-                    std::array<int, 3> dv{};
-
-                    du[ u ] = width;
-                    dv[ v ] = height;
-
-                    const FaceInfo face_info{
-                        .is_front_face = normal_map[ block_index ],
-                        .block_id = face_map[ block_index ],
-                        .width = width,
-                        .height = height,
-                        .v1 = toRenderAreaBlockPos( axis[ x ], axis[ y ], axis[ z ], chunk_pos ),
-                        .v2 = toRenderAreaBlockPos(
-                            axis[ x ] + du[ x ],
-                            axis[ y ] + du[ y ],
-                            axis[ z ] + du[ z ],
-                            chunk_pos ),
-                        .v3 = toRenderAreaBlockPos(
-                            axis[ x ] + dv[ x ],
-                            axis[ y ] + dv[ y ],
-                            axis[ z ] + dv[ z ],
-                            chunk_pos ),
-                        .v4 = toRenderAreaBlockPos(
-                            axis[ x ] + du[ x ] + dv[ x ],
-                            axis[ y ] + du[ y ] + dv[ y ],
-                            axis[ z ] + du[ z ] + dv[ z ],
-                            chunk_pos ) };
-
-                    addFace( face_info );
-
-                    // clear map
-                    for ( int l = 0; l < height; l++ )
+                    for ( int k = 0; k < height; k++ )
                     {
-                        for ( int k = 0; k < width; k++ )
-                        {
-                            cmp_map[ block_index + k + l * u_limits ] = false;
-                        }
+                        faces[ row + k ].clear( first, width );
                     }
 
-                    i += width;
-                    block_index += width;
+                    axis[ u ] = first;
+                    axis[ v ] = row;
+
+                    addQuad( scratch.faces, axes, axis, width, height, is_front_face, face_id );
                 }
             }
         }
-    }
-} /* ChunkMesher::greedyMesh */
+    };
+
+    mesh_axis(
+        FixedAxes<0>{},
+        [ & ]( int layer, int row ) { return rows_x[ layer * Chunk::k_max_height + row ]; },
+        [ & ]( int side, int row ) { return side_rows_x[ side ][ row ]; } );
+    mesh_axis(
+        FixedAxes<1>{},
+        [ & ]( int layer, int row ) { return rows_y[ row * Chunk::k_max_width_length + layer ]; },
+        [ & ]( int side, int row ) { return side_rows_y[ side ][ row ]; } );
+    mesh_axis(
+        FixedAxes<2>{},
+        [ & ]( int layer, int row ) { return rows_z[ layer * Chunk::k_max_width_length + row ]; },
+        []( int, int ) { return NarrowRow{}; } );
+} /* ChunkMesher::binaryMesh */
 
 ChunkMesher::VertexInfo
 ChunkMesher::getVertexInfo()
 {
+    // Both formats are two words: the position and the texture description
+    static_assert( offsetof( Quad, position ) == offsetof( Vertex, position ) );
+    static_assert( offsetof( Quad, tex_descr ) == offsetof( Vertex, tex_descr ) );
+
+    const auto input_rate =
+        ( s_mesh_format == MeshFormat::k_quads ) ? vk::VertexInputRate::eInstance : vk::VertexInputRate::eVertex;
+
     return VertexInfo{
         .binding_descr =
             {
                 { { .binding = 0, //
                     .stride = sizeof( Vertex ),
-                    .inputRate = vk::VertexInputRate::eVertex } } },
+                    .inputRate = input_rate } } },
 
         .attribute_descr = {
             { { .location = 0, //
@@ -0,0 +1,431 @@
+#include "chunk/edit_transaction.h"
+#include "chunk/chunk_man.h"
+#include "chunk/job_system.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace chunk
+{
+
+namespace
+{
+
+constexpr auto k_width = Chunk::k_max_width_length;
+constexpr auto k_section_height = Chunk::k_section_height;
+
+// Sections are unpacked in the linear layout, so the blocks of a column are contiguous
+constexpr int
+toSectionIndex( int x, int y, int z )
+{
+    return LinearLayout::toSectionIndex( x, y, z );
+}
+
+// Chunks of the region touched by the box [ min, end )
+std::vector<pos::ChunkPos>
+getChunksInBox( const ChunkMan& chunk_man, const pos::BlockPos& min, const pos::BlockPos& end )
+{
+    std::vector<pos::ChunkPos> chunk_positions;
+
+    const auto first = ChunkMan::toChunkPos( min );
+    const auto last = ChunkMan::toChunkPos( pos::BlockPos{ end.x - 1, end.y - 1, end.z - 1 } );
+
+    for ( auto x = first.x; x <= last.x; x++ )
+    {
+        for ( auto y = first.y; y <= last.y; y++ )
+        {
+            if ( chunk_man.isGenerated( pos::ChunkPos{ x, y } ) )
+            {
+                chunk_positions.emplace_back( x, y );
+            }
+        }
+    }
+
+    return chunk_positions;
+}
+
+} // namespace
+
+void
+EditTransaction::fillBox( const pos::BlockPos& first, const pos::BlockPos& last, BlockID block_id )
+{
+    m_operations.push_back( Operation{
+        .kind = OperationKind::k_fill,
+        .box = makeBox( first, last ),
+        .block_id = block_id,
+        .replaced_id = BlockID::k_none,
+        .center = {},
+        .radius = 0,
+        .region = nullptr,
+        .is_air_skipped = false } );
+} // EditTransaction::fillBox
+
+void
+EditTransaction::replace( const pos::BlockPos& first, const pos::BlockPos& last, BlockID replaced_id, BlockID block_id )
+{
+    m_operations.push_back( Operation{
+        .kind = OperationKind::k_replace,
+        .box = makeBox( first, last ),
+        .block_id = block_id,
+        .replaced_id = replaced_id,
+        .center = {},
+        .radius = 0,
+        .region = nullptr,
+        .is_air_skipped = false } );
+} // EditTransaction::replace
+
+void
+EditTransaction::fillSphere( const pos::BlockPos& center, int radius, BlockID block_id )
+{
+    assert( radius >= 0 );
+
+    const auto first = pos::BlockPos{ center.x - radius, center.y - radius, center.z - radius };
+    const auto last = pos::BlockPos{ center.x + radius, center.y + radius, center.z + radius };
+
+    m_operations.push_back( Operation{
+        .kind = OperationKind::k_sphere,
+        .box = makeBox( first, last ),
+        .block_id = block_id,
+        .replaced_id = BlockID::k_none,
+        .center = center,
+        .radius = radius,
+        .region = nullptr,
+        .is_air_skipped = false } );
+} // EditTransaction::fillSphere
+
+void
+EditTransaction::paste( const BlockRegion& region, const pos::BlockPos& origin, bool is_air_skipped )
+{
+    const auto end = pos::BlockPos{
+        origin.x + region.getSizeX(),
+        origin.y + region.getSizeY(),
+        origin.z + region.getSizeZ() };
+
+    m_operations.push_back( Operation{
+        .kind = OperationKind::k_paste,
+        .box = Box{ .min = origin, .end = end },
+        .block_id = BlockID::k_none,
+        .replaced_id = BlockID::k_none,
+        .center = {},
+        .radius = 0,
+        .region = &region,
+        .is_air_skipped = is_air_skipped } );
+} // EditTransaction::paste
+
+BlockRegion
+EditTransaction::copy( const pos::BlockPos& first, const pos::BlockPos& last )
+{
+    const auto& chunk_man = ChunkMan::getRef();
+    const auto box = makeBox( first, last );
+
+    auto region = BlockRegion{ box.end.x - box.min.x, box.end.y - box.min.y, box.end.z - box.min.z };
+    const auto chunk_positions = getChunksInBox( chunk_man, box.min, box.end );
+
+    // Chunks fill disjoint columns of the region
+    JobSystem::getRef().parallelFor( chunk_positions.size(), [ & ]( std::size_t index ) {
+        const auto& chunk = chunk_man.getChunk( chunk_positions[ index ] );
+        const auto chunk_pos = chunk.getPosition();
+
+        thread_local SectionBlocks blocks{};
+
+        for ( int section = 0; section < Chunk::k_sections_count; section++ )
+        {
+            const auto section_box = getSectionBox( chunk_pos, section );
+            const auto section_min = section_box.min;
+            const auto part = intersect( box, section_box );
+
+            if ( part.isEmpty() || chunk.getSectionState( section ) == Chunk::SectionState::k_absent )
+            {
+                continue;
+            }
+
+            chunk.decodeSectionLinear( section, blocks );
+
+            for ( auto x = part.min.x; x < part.end.x; x++ )
+            {
+                for ( auto y = part.min.y; y < part.end.y; y++ )
+                {
+                    const auto first_index =
+                        toSectionIndex( x - section_min.x, y - section_min.y, part.min.z - section_min.z );
+                    const auto column = region.getColumn( x - box.min.x, y - box.min.y );
+
+                    std::copy_n(
+                        blocks.begin() + first_index,
+                        part.end.z - part.min.z,
+                        column.begin() + ( part.min.z - box.min.z ) );
+                }
+            }
+        }
+    } );
+
+    return region;
+} // EditTransaction::copy
+
+std::size_t
+EditTransaction::commit()
+{
+    auto& chunk_man = ChunkMan::getRef();
+    std::vector<pos::ChunkPos> chunk_positions;
+
+    for ( const auto& operation : m_operations )
+    {
+        if ( !operation.box.isEmpty() )
+        {
+            const auto operation_chunks = getChunksInBox( chunk_man, operation.box.min, operation.box.end );
+            chunk_positions.insert( chunk_positions.end(), operation_chunks.begin(), operation_chunks.end() );
+        }
+    }
+
+    // Every chunk is edited once by all the operations
+    auto is_less = []( const pos::ChunkPos& lhs, const pos::ChunkPos& rhs ) {
+        return lhs.x < rhs.x || ( lhs.x == rhs.x && lhs.y < rhs.y );
+    };
+
+    std::sort( chunk_positions.begin(), chunk_positions.end(), is_less );
+    chunk_positions.erase( std::unique( chunk_positions.begin(), chunk_positions.end() ), chunk_positions.end() );
+
+    std::vector<ChunkChanges> chunk_changes( chunk_positions.size() );
+
+    JobSystem::getRef().parallelFor( chunk_positions.size(), [ & ]( std::size_t index ) {
+        chunk_changes[ index ] = applyToChunk( chunk_man.getChunk( chunk_positions[ index ] ) );
+    } );
+
+    m_operations.clear();
+
+    // Dirty flags are set after all the chunks are edited, a chunk touched by several operations
+    // or by the neighbours is remeshed once anyway
+    std::size_t changed_count = 0;
+
+    for ( std::size_t index = 0; index < chunk_positions.size(); index++ )
+    {
+        const auto& changes = chunk_changes[ index ];
+        const auto& chunk_pos = chunk_positions[ index ];
+
+        if ( !changes.is_changed )
+        {
+            continue;
+        }
+
+        const auto neighbours = std::array{
+            pos::ChunkPos{ chunk_pos.x - 1, chunk_pos.y },
+            pos::ChunkPos{ chunk_pos.x + 1, chunk_pos.y },
+            pos::ChunkPos{ chunk_pos.x, chunk_pos.y - 1 },
+            pos::ChunkPos{ chunk_pos.x, chunk_pos.y + 1 } };
+
+        chunk_man.markDirty( chunk_pos );
+        changed_count++;
+
+        for ( std::size_t border = 0; border < neighbours.size(); border++ )
+        {
+            if ( changes.is_border_changed[ border ] )
+            {
+                chunk_man.markDirty( neighbours[ border ] );
+            }
+        }
+    }
+
+    return changed_count;
+} // EditTransaction::commit
+
+EditTransaction::Box
+EditTransaction::makeBox( const pos::BlockPos& first, const pos::BlockPos& last )
+{
+    return Box{
+        .min = pos::BlockPos{ std::min( first.x, last.x ), std::min( first.y, last.y ), std::min( first.z, last.z ) },
+        .end = pos::BlockPos{
+            std::max( first.x, last.x ) + 1,
+            std::max( first.y, last.y ) + 1,
+            std::max( first.z, last.z ) + 1 } };
+} // EditTransaction::makeBox
+
+EditTransaction::Box
+EditTransaction::intersect( const Box& lhs, const Box& rhs )
+{
+    return Box{
+        .min = pos::BlockPos{ std::max( lhs.min.x, rhs.min.x ),
+                              std::max( lhs.min.y, rhs.min.y ),
+                              std::max( lhs.min.z, rhs.min.z ) },
+        .end = pos::BlockPos{ std::min( lhs.end.x, rhs.end.x ),
+                              std::min( lhs.end.y, rhs.end.y ),
+                              std::min( lhs.end.z, rhs.end.z ) } };
+} // EditTransaction::intersect
+
+EditTransaction::Box
+EditTransaction::getSectionBox( const pos::ChunkPos& chunk_pos, int section )
+{
+    return Box{
+        .min = pos::BlockPos{ chunk_pos.x * k_width, chunk_pos.y * k_width, section * k_section_height },
+        .end = pos::BlockPos{
+            ( chunk_pos.x + 1 ) * k_width,
+            ( chunk_pos.y + 1 ) * k_width,
+            ( section + 1 ) * k_section_height } };
+} // EditTransaction::getSectionBox
+
+EditTransaction::ChunkChanges
+EditTransaction::applyToChunk( Chunk& chunk ) const
+{
+    const auto chunk_pos = chunk.getPosition();
+    auto changes = ChunkChanges{ .is_changed = false, .is_border_changed = {} };
+
+    // Scratch section is per thread, so chunks are edited by several jobs at once
+    thread_local SectionBlocks blocks{};
+
+    for ( int section = 0; section < Chunk::k_sections_count; section++ )
+    {
+        const auto section_box = getSectionBox( chunk_pos, section );
+
+        bool is_decoded = false;
+        bool is_section_changed = false;
+
+        for ( const auto& operation : m_operations )
+        {
+            const auto part = intersect( operation.box, section_box );
+
+            if ( part.isEmpty() )
+            {
+                continue;
+            }
+
+            // The absent or uniform section covered by the fill becomes uniform without unpacking. Every block
+            // of it is changed, unless it's already filled with the same block
+            const bool is_packed_fill = operation.kind == OperationKind::k_fill && part == section_box &&
+                !is_decoded && chunk.getSectionState( section ) != Chunk::SectionState::k_dense;
+
+            if ( is_packed_fill )
+            {
+                if ( chunk[ section * Chunk::k_section_block_count ] != operation.block_id )
+                {
+                    chunk.fillSection( section, operation.block_id );
+                    changes.merge( ChunkChanges{
+                        .is_changed = true,
+                        .is_border_changed = { true, true, true, true } } );
+                }
+
+                continue;
+            }
+
+            if ( !is_decoded )
+            {
+                chunk.decodeSectionLinear( section, blocks );
+                is_decoded = true;
+            }
+
+            const auto section_changes = applyToSection( operation, part, section_box.min, blocks );
+
+            is_section_changed |= section_changes.is_changed;
+            changes.merge( section_changes );
+        }
+
+        if ( is_section_changed )
+        {
+            chunk.encodeSectionLinear( section, blocks );
+        }
+    }
+
+    return changes;
+} // EditTransaction::applyToChunk
+
+EditTransaction::ChunkChanges
+EditTransaction::applyToSection(
+    const Operation& operation,
+    const Box& part,
+    const pos::BlockPos& section_min,
+    SectionBlocks& blocks )
+{
+    auto changes = ChunkChanges{ .is_changed = false, .is_border_changed = {} };
+
+    // Blocks of the section with the same x and y are stored one after another, so the operations
+    // are applied to these columns
+    for ( auto x = part.min.x; x < part.end.x; x++ )
+    {
+        for ( auto y = part.min.y; y < part.end.y; y++ )
+        {
+            auto column_begin = part.min.z;
+            auto column_end = part.end.z;
+
+            if ( operation.kind == OperationKind::k_sphere )
+            {
+                const auto dx = x - operation.center.x;
+                const auto dy = y - operation.center.y;
+                const auto rest = operation.radius * operation.radius - dx * dx - dy * dy;
+
+                if ( rest < 0 )
+                {
+                    continue;
+                }
+
+                // The column of the sphere is [ center - dz, center + dz ]
+                auto dz = static_cast<int>( std::sqrt( static_cast<double>( rest ) ) );
+                while ( dz * dz > rest )
+                {
+                    dz--;
+                }
+
+                column_begin = std::max( column_begin, operation.center.z - dz );
+                column_end = std::min( column_end, operation.center.z + dz + 1 );
+
+                if ( column_begin >= column_end )
+                {
+                    continue;
+                }
+            }
+
+            const auto begin = blocks.begin() +
+                toSectionIndex( x - section_min.x, y - section_min.y, column_begin - section_min.z );
+            const auto end = begin + ( column_end - column_begin );
+
+            // Blocks are compared with the written ones, so the column is changed only by the new ids
+            bool is_column_changed = false;
+
+            const auto write = [ &is_column_changed ]( BlockID& block, BlockID block_id ) {
+                is_column_changed |= ( block != block_id );
+                block = block_id;
+            };
+
+            switch ( operation.kind )
+            {
+            case OperationKind::k_fill:
+            case OperationKind::k_sphere:
+                std::for_each( begin, end, [ & ]( BlockID& block ) { write( block, operation.block_id ); } );
+                break;
+            case OperationKind::k_replace:
+                std::for_each( begin, end, [ & ]( BlockID& block ) {
+                    if ( block == operation.replaced_id )
+                    {
+                        write( block, operation.block_id );
+                    }
+                } );
+                break;
+            case OperationKind::k_paste: {
+                const auto& region = *operation.region;
+                const auto column = region.getColumn( x - operation.box.min.x, y - operation.box.min.y )
+                                        .subspan( column_begin - operation.box.min.z, column_end - column_begin );
+
+                for ( std::size_t index = 0; index < column.size(); index++ )
+                {
+                    if ( !operation.is_air_skipped || column[ index ] != BlockID::k_none )
+                    {
+                        write( begin[ index ], column[ index ] );
+                    }
+                }
+                break;
+            }
+            default:
+                assert( 0 && "Unknown operation kind" );
+            }
+
+            if ( is_column_changed )
+            {
+                changes.is_changed = true;
+                changes.is_border_changed[ 0 ] |= ( x == section_min.x );
+                changes.is_border_changed[ 1 ] |= ( x == section_min.x + k_width - 1 );
+                changes.is_border_changed[ 2 ] |= ( y == section_min.y );
+                changes.is_border_changed[ 3 ] |= ( y == section_min.y + k_width - 1 );
+            }
+        }
+    }
+
+    return changes;
+} // EditTransaction::applyToSection
+
+}; // namespace chunk
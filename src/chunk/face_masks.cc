@@ -0,0 +1,254 @@
+#include "chunk/face_masks.h"
+#include "utils/misc.h"
+
+#include <cassert>
+#include <cstddef>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define CHUNK_FACE_MASKS_X86
+#include <immintrin.h>
+#endif
+
+namespace chunk
+{
+
+namespace
+{
+
+using FaceMasksKernel = void ( * )(
+    const BlockID* current,
+    const BlockID* next,
+    std::size_t count,
+    bool is_lower_side,
+    bool is_upper_side,
+    bool* cmp,
+    bool* normal,
+    BlockID* face );
+
+void
+buildFaceMasksScalar(
+    const BlockID* current,
+    const BlockID* next,
+    std::size_t count,
+    bool is_lower_side,
+    bool is_upper_side,
+    bool* cmp,
+    bool* normal,
+    BlockID* face )
+{
+    for ( std::size_t i = 0; i < count; i++ )
+    {
+        const bool is_current_air = ( current[ i ] == BlockID::k_none );
+        const bool is_next_air = ( next[ i ] == BlockID::k_none );
+
+        // the face of the neighbour block is made by the neighbour chunk
+        const bool is_neighbour_face = ( is_lower_side && is_next_air ) || ( is_upper_side && !is_next_air );
+
+        cmp[ i ] = ( is_current_air != is_next_air ) && !is_neighbour_face;
+        face[ i ] = is_next_air ? current[ i ] : next[ i ];
+        normal[ i ] = is_next_air;
+    }
+} // buildFaceMasksScalar
+
+#ifdef CHUNK_FACE_MASKS_X86
+
+// Kernels are compiled for their instruction sets only, the rest of the code doesn't depend on them
+
+__attribute__( ( target( "sse4.1" ) ) ) void
+buildFaceMasksSse41(
+    const BlockID* current,
+    const BlockID* next,
+    std::size_t count,
+    bool is_lower_side,
+    bool is_upper_side,
+    bool* cmp,
+    bool* normal,
+    BlockID* face )
+{
+    constexpr std::size_t k_lanes = 8;
+
+    const auto air = _mm_set1_epi16( static_cast<short>( utils::toUnderlying( BlockID::k_none ) ) );
+    const auto lower = _mm_set1_epi16( is_lower_side ? -1 : 0 );
+    const auto upper = _mm_set1_epi16( is_upper_side ? -1 : 0 );
+    const auto ones = _mm_set1_epi8( 1 );
+
+    std::size_t i = 0;
+
+    for ( ; i + k_lanes <= count; i += k_lanes )
+    {
+        const auto current_blocks = _mm_loadu_si128( reinterpret_cast<const __m128i*>( current + i ) );
+        const auto next_blocks = _mm_loadu_si128( reinterpret_cast<const __m128i*>( next + i ) );
+
+        const auto is_current_air = _mm_cmpeq_epi16( current_blocks, air );
+        const auto is_next_air = _mm_cmpeq_epi16( next_blocks, air );
+
+        const auto is_neighbour_face =
+            _mm_or_si128( _mm_and_si128( lower, is_next_air ), _mm_andnot_si128( is_next_air, upper ) );
+        const auto is_face = _mm_andnot_si128( is_neighbour_face, _mm_xor_si128( is_current_air, is_next_air ) );
+
+        // masks of 16 bits are narrowed to the bytes of bool
+        const auto cmp_bytes = _mm_and_si128( _mm_packs_epi16( is_face, is_face ), ones );
+        const auto normal_bytes = _mm_and_si128( _mm_packs_epi16( is_next_air, is_next_air ), ones );
+
+        _mm_storel_epi64( reinterpret_cast<__m128i*>( cmp + i ), cmp_bytes );
+        _mm_storel_epi64( reinterpret_cast<__m128i*>( normal + i ), normal_bytes );
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>( face + i ),
+            _mm_blendv_epi8( next_blocks, current_blocks, is_next_air ) );
+    }
+
+    buildFaceMasksScalar(
+        current + i,
+        next + i,
+        count - i,
+        is_lower_side,
+        is_upper_side,
+        cmp + i,
+        normal + i,
+        face + i );
+} // buildFaceMasksSse41
+
+// Masks of 16 bits are narrowed to the bytes of bool, halves are packed together to keep the order
+__attribute__( ( target( "avx2" ) ) ) __m128i
+narrowMask( __m256i mask )
+{
+    const auto packed = _mm_packs_epi16( _mm256_castsi256_si128( mask ), _mm256_extracti128_si256( mask, 1 ) );
+    return _mm_and_si128( packed, _mm_set1_epi8( 1 ) );
+} // narrowMask
+
+__attribute__( ( target( "avx2" ) ) ) void
+buildFaceMasksAvx2(
+    const BlockID* current,
+    const BlockID* next,
+    std::size_t count,
+    bool is_lower_side,
+    bool is_upper_side,
+    bool* cmp,
+    bool* normal,
+    BlockID* face )
+{
+    constexpr std::size_t k_lanes = 16;
+
+    const auto air = _mm256_set1_epi16( static_cast<short>( utils::toUnderlying( BlockID::k_none ) ) );
+    const auto lower = _mm256_set1_epi16( is_lower_side ? -1 : 0 );
+    const auto upper = _mm256_set1_epi16( is_upper_side ? -1 : 0 );
+
+    std::size_t i = 0;
+
+    for ( ; i + k_lanes <= count; i += k_lanes )
+    {
+        const auto current_blocks = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( current + i ) );
+        const auto next_blocks = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( next + i ) );
+
+        const auto is_current_air = _mm256_cmpeq_epi16( current_blocks, air );
+        const auto is_next_air = _mm256_cmpeq_epi16( next_blocks, air );
+
+        const auto is_neighbour_face =
+            _mm256_or_si256( _mm256_and_si256( lower, is_next_air ), _mm256_andnot_si256( is_next_air, upper ) );
+        const auto is_face = _mm256_andnot_si256( is_neighbour_face, _mm256_xor_si256( is_current_air, is_next_air ) );
+
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( cmp + i ), narrowMask( is_face ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( normal + i ), narrowMask( is_next_air ) );
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>( face + i ),
+            _mm256_blendv_epi8( next_blocks, current_blocks, is_next_air ) );
+    }
+
+    // The rest is less than 16 blocks, rows of the planes are usually 16 blocks wide. Upper halves of the registers
+    // are cleared, otherwise the SSE code after the kernel is stalled
+    _mm256_zeroupper();
+
+    buildFaceMasksSse41(
+        current + i,
+        next + i,
+        count - i,
+        is_lower_side,
+        is_upper_side,
+        cmp + i,
+        normal + i,
+        face + i );
+} // buildFaceMasksAvx2
+
+#endif // CHUNK_FACE_MASKS_X86
+
+FaceMasksKernel
+getKernel( FaceMasksIsa isa )
+{
+    switch ( isa )
+    {
+#ifdef CHUNK_FACE_MASKS_X86
+    case FaceMasksIsa::k_avx2:
+        return buildFaceMasksAvx2;
+    case FaceMasksIsa::k_sse41:
+        return buildFaceMasksSse41;
+#endif
+    default:
+        return buildFaceMasksScalar;
+    }
+} // getKernel
+
+FaceMasksIsa g_face_masks_isa = getSupportedFaceMasksIsa();
+FaceMasksKernel g_face_masks_kernel = getKernel( g_face_masks_isa );
+
+} // namespace
+
+FaceMasksIsa
+getSupportedFaceMasksIsa()
+{
+#ifdef CHUNK_FACE_MASKS_X86
+    // the instruction set is chosen during the static initialization, when the CPU may be not detected yet
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports( "avx2" ) )
+    {
+        return FaceMasksIsa::k_avx2;
+    }
+
+    if ( __builtin_cpu_supports( "sse4.1" ) )
+    {
+        return FaceMasksIsa::k_sse41;
+    }
+#endif
+
+    return FaceMasksIsa::k_scalar;
+} // getSupportedFaceMasksIsa
+
+void
+setFaceMasksIsa( FaceMasksIsa isa )
+{
+    assert( isa <= getSupportedFaceMasksIsa() && "Instruction set is not supported by the CPU" );
+
+    g_face_masks_isa = isa;
+    g_face_masks_kernel = getKernel( isa );
+} // setFaceMasksIsa
+
+FaceMasksIsa
+getFaceMasksIsa()
+{
+    return g_face_masks_isa;
+} // getFaceMasksIsa
+
+void
+buildFaceMasks(
+    std::span<const BlockID> current,
+    std::span<const BlockID> next,
+    bool is_lower_side,
+    bool is_upper_side,
+    const FaceMasks& masks )
+{
+    assert( current.size() == next.size() );
+    assert( masks.cmp.size() == current.size() && masks.normal.size() == current.size() );
+    assert( masks.face.size() == current.size() );
+
+    g_face_masks_kernel(
+        current.data(),
+        next.data(),
+        current.size(),
+        is_lower_side,
+        is_upper_side,
+        masks.cmp.data(),
+        masks.normal.data(),
+        masks.face.data() );
+} // buildFaceMasks
+
+}; // namespace chunk
@@ -0,0 +1,243 @@
+#include "chunk/job_system.h"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <limits>
+
+namespace chunk
+{
+
+namespace
+{
+
+// Pool and index of the worker the current thread belongs to
+thread_local const JobSystem* t_job_system = nullptr;
+thread_local unsigned t_worker_index = std::numeric_limits<unsigned>::max();
+
+} // namespace
+
+JobSystem::JobSystem( unsigned workers_count )
+{
+    workers_count = std::max( workers_count, 1u );
+
+    m_workers.reserve( workers_count );
+    for ( unsigned index = 0; index < workers_count; index++ )
+    {
+        m_workers.push_back( std::make_unique<Worker>() );
+    }
+
+    m_threads.reserve( workers_count );
+    for ( unsigned index = 0; index < workers_count; index++ )
+    {
+        m_threads.emplace_back( [ this, index ]() { workerLoop( index ); } );
+    }
+} // JobSystem::JobSystem
+
+JobSystem::~JobSystem()
+{
+    {
+        auto lock = std::lock_guard{ m_sleep_mutex };
+        m_stop = true;
+    }
+
+    m_sleep_cv.notify_all();
+    m_threads.clear(); // Join the workers
+} // JobSystem::~JobSystem
+
+unsigned
+JobSystem::getCurrentWorkerIndex() const
+{
+    return t_job_system == this ? t_worker_index : getWorkersCount();
+} // JobSystem::getCurrentWorkerIndex
+
+void
+JobSystem::submit( Job job, JobPriority priority )
+{
+    assert( priority < JobPriority::k_max );
+
+    // Workers push to their own deques, other threads spread the jobs between the workers
+    auto worker_index = getCurrentWorkerIndex();
+    if ( worker_index == getWorkersCount() )
+    {
+        worker_index = m_next_worker.fetch_add( 1, std::memory_order_relaxed ) % getWorkersCount();
+    }
+
+    auto& worker = *m_workers[ worker_index ];
+    {
+        auto lock = std::lock_guard{ worker.mutex };
+        worker.jobs[ static_cast<std::size_t>( priority ) ].push_back( std::move( job ) );
+    }
+
+    {
+        // Under the lock, so that a worker going to sleep doesn't miss the job
+        auto lock = std::lock_guard{ m_sleep_mutex };
+        m_pending_count.fetch_add( 1, std::memory_order_release );
+    }
+
+    m_sleep_cv.notify_one();
+} // JobSystem::submit
+
+void
+JobSystem::parallelFor( std::size_t count, const std::function<void( std::size_t )>& func, JobPriority priority )
+{
+    if ( count == 0 )
+    {
+        return;
+    }
+
+    // Split the range into batches, so that every worker gets a few of them to balance the load by stealing
+    const auto batches_count = std::min<std::size_t>( count, 4 * getWorkersCount() );
+    const auto batch_size = ( count + batches_count - 1 ) / batches_count;
+
+    auto remaining = std::atomic<std::size_t>{ batches_count };
+    auto exception = std::exception_ptr{};
+    auto exception_mutex = std::mutex{};
+
+    for ( std::size_t batch = 0; batch < batches_count; batch++ )
+    {
+        const auto begin = batch * batch_size;
+        const auto end = std::min( count, begin + batch_size );
+
+        submit(
+            [ &, begin, end ]() {
+                try
+                {
+                    for ( auto index = begin; index < end; index++ )
+                    {
+                        func( index );
+                    }
+                } catch ( ... )
+                {
+                    auto lock = std::lock_guard{ exception_mutex };
+                    exception = std::current_exception();
+                }
+
+                remaining.fetch_sub( 1, std::memory_order_acq_rel );
+            },
+            priority );
+    }
+
+    // Help the workers instead of blocking, the caller may be a worker itself
+    while ( remaining.load( std::memory_order_acquire ) != 0 )
+    {
+        if ( !tryRunPendingJob() )
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    if ( exception )
+    {
+        std::rethrow_exception( exception );
+    }
+} // JobSystem::parallelFor
+
+bool
+JobSystem::tryRunPendingJob()
+{
+    auto job = Job{};
+
+    if ( !takeJob( getCurrentWorkerIndex(), job ) )
+    {
+        return false;
+    }
+
+    job();
+    return true;
+} // JobSystem::tryRunPendingJob
+
+void
+JobSystem::workerLoop( unsigned worker_index )
+{
+    t_job_system = this;
+    t_worker_index = worker_index;
+
+    while ( true )
+    {
+        auto job = Job{};
+
+        if ( takeJob( worker_index, job ) )
+        {
+            job();
+            continue;
+        }
+
+        auto lock = std::unique_lock{ m_sleep_mutex };
+        m_sleep_cv.wait( lock, [ this ]() {
+            return m_stop || m_pending_count.load( std::memory_order_acquire ) != 0;
+        } );
+
+        if ( m_stop )
+        {
+            return;
+        }
+    }
+} // JobSystem::workerLoop
+
+bool
+JobSystem::popOwnJob( unsigned worker_index, std::size_t priority, Job& job )
+{
+    auto& worker = *m_workers[ worker_index ];
+    auto lock = std::lock_guard{ worker.mutex };
+    auto& jobs = worker.jobs[ priority ];
+
+    if ( jobs.empty() )
+    {
+        return false;
+    }
+
+    // The newest job is the hottest in the cache
+    job = std::move( jobs.back() );
+    jobs.pop_back();
+    return true;
+} // JobSystem::popOwnJob
+
+bool
+JobSystem::stealJob( unsigned thief_index, std::size_t priority, Job& job )
+{
+    const auto workers_count = getWorkersCount();
+
+    for ( unsigned offset = 1; offset <= workers_count; offset++ )
+    {
+        const auto victim_index = ( thief_index + offset ) % workers_count;
+        if ( victim_index == thief_index )
+        {
+            continue;
+        }
+
+        auto& victim = *m_workers[ victim_index ];
+        auto lock = std::lock_guard{ victim.mutex };
+        auto& jobs = victim.jobs[ priority ];
+
+        if ( !jobs.empty() )
+        {
+            // The oldest job is likely the biggest one and the coldest for the victim
+            job = std::move( jobs.front() );
+            jobs.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+} // JobSystem::stealJob
+
+bool
+JobSystem::takeJob( unsigned worker_index, Job& job )
+{
+    // A thread outside of the pool has no deque and only steals
+    const auto is_worker = worker_index < getWorkersCount();
+
+    for ( std::size_t priority = 0; priority < k_priorities_count; priority++ )
+    {
+        if ( ( is_worker && popOwnJob( worker_index, priority, job ) ) || stealJob( worker_index, priority, job ) )
+        {
+            m_pending_count.fetch_sub( 1, std::memory_order_acq_rel );
+            return true;
+        }
+    }
+
+    return false;
+} // JobSystem::takeJob
+
+}; // namespace chunk
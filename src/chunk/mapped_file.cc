@@ -0,0 +1,114 @@
+#include "chunk/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace chunk
+{
+
+MappedFile::MappedFile( const std::filesystem::path& path )
+{
+    const auto descriptor = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+    if ( descriptor < 0 )
+    {
+        throw std::runtime_error( "Failed to open " + path.string() + ": " + std::strerror( errno ) );
+    }
+
+    struct stat file_stat
+    {
+    };
+
+    if ( ::fstat( descriptor, &file_stat ) != 0 )
+    {
+        const auto error = errno;
+        ::close( descriptor );
+        throw std::runtime_error( "Failed to stat " + path.string() + ": " + std::strerror( error ) );
+    }
+
+    // Empty file can't be mapped, its mapping is empty as well
+    if ( file_stat.st_size == 0 )
+    {
+        ::close( descriptor );
+        return;
+    }
+
+    auto* data = ::mmap( nullptr, static_cast<std::size_t>( file_stat.st_size ), PROT_READ, MAP_SHARED, descriptor, 0 );
+
+    // The mapping holds the file by itself
+    ::close( descriptor );
+
+    if ( data == MAP_FAILED )
+    {
+        throw std::runtime_error( "Failed to map " + path.string() + ": " + std::strerror( errno ) );
+    }
+
+    m_data = static_cast<const uint8_t*>( data );
+    m_size = static_cast<std::size_t>( file_stat.st_size );
+
+    // Chunks are read by the offset table, not from the beginning to the end. Reading ahead is requested
+    // explicitly for the chunks that are going to be loaded
+    ::madvise( data, m_size, MADV_RANDOM );
+} // MappedFile::MappedFile
+
+MappedFile::MappedFile( MappedFile&& other ) noexcept
+    : m_data( std::exchange( other.m_data, nullptr ) ),
+      m_size( std::exchange( other.m_size, 0 ) )
+{
+} // MappedFile::MappedFile
+
+MappedFile&
+MappedFile::operator=( MappedFile&& other ) noexcept
+{
+    if ( this != &other )
+    {
+        unmap();
+        m_data = std::exchange( other.m_data, nullptr );
+        m_size = std::exchange( other.m_size, 0 );
+    }
+
+    return *this;
+} // MappedFile::operator=
+
+MappedFile::~MappedFile()
+{
+    unmap();
+} // MappedFile::~MappedFile
+
+void
+MappedFile::prefetch( std::size_t offset, std::size_t size ) const
+{
+    if ( offset >= m_size || size == 0 )
+    {
+        return;
+    }
+
+    // madvise requires the address aligned to the page
+    static const auto page_size = static_cast<std::size_t>( ::sysconf( _SC_PAGESIZE ) );
+
+    const auto begin = offset / page_size * page_size;
+    const auto end = std::min( offset + size, m_size );
+
+    ::madvise( const_cast<uint8_t*>( m_data ) + begin, end - begin, MADV_WILLNEED );
+} // MappedFile::prefetch
+
+void
+MappedFile::unmap()
+{
+    if ( m_data )
+    {
+        ::munmap( const_cast<uint8_t*>( m_data ), m_size );
+        m_data = nullptr;
+        m_size = 0;
+    }
+} // MappedFile::unmap
+
+}; // namespace chunk
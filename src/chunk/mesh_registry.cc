@@ -0,0 +1,190 @@
+#include "chunk/mesh_registry.h"
+#include "chunk/job_system.h"
+
+#include <cassert>
+#include <optional>
+#include <utility>
+
+namespace chunk
+{
+
+MeshRegistry::MeshUpdate
+MeshRegistry::collectUpdate() const
+{
+    auto&& chunk_man = ChunkMan::getRef();
+    const auto render_distance = chunk_man.getRenderDistance();
+    const auto side_length = 2 * render_distance + 1;
+    const auto area_corner = chunk_man.getOriginPos() - pos::ChunkPos{ render_distance, render_distance };
+
+    MeshUpdate update;
+
+    for ( const auto& [ position, mesh ] : m_meshes )
+    {
+        if ( !chunk_man.isInRegion( position ) )
+        {
+            update.removed.push_back( position );
+        }
+    }
+
+    std::vector<pos::ChunkPos> outdated;
+
+    for ( int x = 0; x < side_length; x++ )
+    {
+        for ( int y = 0; y < side_length; y++ )
+        {
+            if ( const auto position = area_corner + pos::ChunkPos{ x, y }; isOutdated( position ) )
+            {
+                outdated.push_back( position );
+            }
+        }
+    }
+
+    // Every chunk is meshed by a job into its own slot, so the update doesn't depend on the scheduling
+    std::vector<std::optional<ChunkMesh>> meshes( outdated.size() );
+
+    // One context for every worker and one for the calling thread, which helps the workers
+    auto&& job_system = JobSystem::getRef();
+    m_contexts.resize( job_system.getWorkersCount() + 1 );
+
+    job_system.parallelFor( outdated.size(), [ & ]( std::size_t index ) {
+        const auto& position = outdated[ index ];
+
+        // The chunk is skipped, if it's not ready or is meshed by someone else
+        const auto state = chunk_man.getChunkState( position );
+        if ( state == ChunkState::k_meshing || !chunk_man.isReadyForMeshing( position ) ||
+             !chunk_man.tryChangeState( position, state, ChunkState::k_meshing ) )
+        {
+            return;
+        }
+
+        chunk_man.clearDirty( position );
+        auto& context = m_contexts[ job_system.getCurrentWorkerIndex() ];
+        meshes[ index ] = ChunkMesher::meshChunk( position, context );
+
+        [[maybe_unused]] auto is_meshed =
+            chunk_man.tryChangeState( position, ChunkState::k_meshing, ChunkState::k_meshed );
+        assert( is_meshed );
+    } );
+
+    for ( auto& mesh : meshes )
+    {
+        if ( mesh )
+        {
+            update.meshes.push_back( std::move( *mesh ) );
+        }
+    }
+
+    return update;
+} // MeshRegistry::collectUpdate
+
+void
+MeshRegistry::applyUpdate( MeshUpdate update )
+{
+    for ( const auto& position : update.removed )
+    {
+        m_meshes.erase( position );
+    }
+
+    for ( auto& mesh : update.meshes )
+    {
+        const auto position = mesh.position;
+        m_meshes.insert_or_assign( position, std::move( mesh ) );
+    }
+} // MeshRegistry::applyUpdate
+
+void
+MeshRegistry::markUploaded() const
+{
+    auto&& chunk_man = ChunkMan::getRef();
+
+    for ( const auto& [ position, mesh ] : m_meshes )
+    {
+        // The region could be moved since the chunk was meshed
+        if ( chunk_man.isInRegion( position ) )
+        {
+            chunk_man.tryChangeState( position, ChunkState::k_meshed, ChunkState::k_uploaded );
+        }
+    }
+} // MeshRegistry::markUploaded
+
+std::size_t
+MeshRegistry::getVerticesCount() const
+{
+    std::size_t vertices_count = 0;
+
+    for ( const auto& [ position, mesh ] : m_meshes )
+    {
+        vertices_count += mesh.vertices.size();
+    }
+
+    return vertices_count;
+} // MeshRegistry::getVerticesCount
+
+std::size_t
+MeshRegistry::getIndicesCount() const
+{
+    std::size_t indices_count = 0;
+
+    for ( const auto& [ position, mesh ] : m_meshes )
+    {
+        indices_count += mesh.getIndicesCount();
+    }
+
+    return indices_count;
+} // MeshRegistry::getIndicesCount
+
+std::size_t
+MeshRegistry::getQuadsCount() const
+{
+    std::size_t quads_count = 0;
+
+    for ( const auto& [ position, mesh ] : m_meshes )
+    {
+        quads_count += mesh.quads.size();
+    }
+
+    return quads_count;
+} // MeshRegistry::getQuadsCount
+
+std::size_t
+MeshRegistry::getAllocatedBytesCount() const
+{
+    std::size_t bytes_count = 0;
+
+    for ( const auto& [ position, mesh ] : m_meshes )
+    {
+        bytes_count += mesh.vertices.capacity() * sizeof( decltype( mesh.vertices )::value_type ) +
+            mesh.indices.capacity() * sizeof( decltype( mesh.indices )::value_type ) +
+            mesh.wide_indices.capacity() * sizeof( decltype( mesh.wide_indices )::value_type ) +
+            mesh.quads.capacity() * sizeof( decltype( mesh.quads )::value_type );
+    }
+
+    return bytes_count;
+} // MeshRegistry::getAllocatedBytesCount
+
+bool
+MeshRegistry::isOutdated( const pos::ChunkPos& position ) const
+{
+    auto&& chunk_man = ChunkMan::getRef();
+    const auto* mesh = findMesh( position );
+
+    if ( !mesh || chunk_man.isDirty( position ) )
+    {
+        return true;
+    }
+
+    // Sides are closed only while the neighbours are not generated
+    const auto neighbours = ChunkMan::getNeighbourPositions( position );
+
+    for ( std::size_t side = 0; side < neighbours.size(); side++ )
+    {
+        if ( mesh->is_side_closed[ side ] == chunk_man.isGenerated( neighbours[ side ] ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+} // MeshRegistry::isOutdated
+
+}; // namespace chunk
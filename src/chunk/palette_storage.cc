@@ -0,0 +1,183 @@
+#include "chunk/palette_storage.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace chunk
+{
+
+uint32_t
+PaletteStorage::indexBitsFor( std::size_t palette_size )
+{
+    if ( palette_size <= 1 )
+    {
+        return 0;
+    }
+
+    const auto bits = static_cast<uint32_t>( std::bit_width( palette_size - 1 ) );
+    return std::bit_ceil( bits );
+} // PaletteStorage::indexBitsFor
+
+void
+PaletteStorage::repack( uint32_t new_index_bits )
+{
+    assert( new_index_bits == 0 || ( std::size_t{ 1 } << new_index_bits ) >= m_palette.size() );
+
+    if ( new_index_bits == 0 )
+    {
+        m_indices = {};
+        m_index_bits = 0;
+        m_index_bits_log2 = 0;
+        m_index_mask = 0;
+        return;
+    }
+
+    auto old_storage = std::move( *this );
+
+    const auto new_bits_log2 = static_cast<uint32_t>( std::countr_zero( new_index_bits ) );
+    const auto per_word_log2 = k_word_bits_log2 - new_bits_log2;
+
+    m_size = old_storage.m_size;
+    m_palette = std::move( old_storage.m_palette );
+    m_index_bits = new_index_bits;
+    m_index_bits_log2 = new_bits_log2;
+    m_index_mask = ( Word{ 1 } << new_index_bits ) - 1;
+    m_indices.assign( ( m_size + ( std::size_t{ 1 } << per_word_log2 ) - 1 ) >> per_word_log2, 0 );
+
+    if ( old_storage.isUniform() )
+    {
+        // All old indices are zero, the same as freshly allocated words
+        return;
+    }
+
+    for ( std::size_t index = 0; index < m_size; ++index )
+    {
+        writeIndex( index, old_storage.readIndex( index ) );
+    }
+} // PaletteStorage::repack
+
+void
+PaletteStorage::set( std::size_t index, BlockID block_id )
+{
+    assert( index < m_size );
+
+    auto found = std::find( m_palette.begin(), m_palette.end(), block_id );
+    const auto palette_index = static_cast<uint32_t>( found - m_palette.begin() );
+
+    if ( found == m_palette.end() )
+    {
+        m_palette.push_back( block_id );
+
+        if ( const auto needed_bits = indexBitsFor( m_palette.size() ); needed_bits > m_index_bits )
+        {
+            repack( needed_bits );
+        }
+    }
+
+    if ( isUniform() )
+    {
+        // The only palette entry is block_id itself
+        return;
+    }
+
+    writeIndex( index, palette_index );
+} // PaletteStorage::set
+
+void
+PaletteStorage::fill( BlockID block_id )
+{
+    m_palette.assign( 1, block_id );
+    repack( 0 );
+} // PaletteStorage::fill
+
+void
+PaletteStorage::decode( std::span<BlockID> blocks ) const
+{
+    assert( blocks.size() == m_size );
+
+    if ( isUniform() )
+    {
+        std::fill( blocks.begin(), blocks.end(), m_palette[ 0 ] );
+        return;
+    }
+
+    const auto per_word = std::size_t{ 1 } << ( k_word_bits_log2 - m_index_bits_log2 );
+    auto out = blocks.begin();
+
+    for ( auto word : m_indices )
+    {
+        const auto count = std::min<std::size_t>( per_word, static_cast<std::size_t>( blocks.end() - out ) );
+
+        for ( std::size_t i = 0; i < count; ++i )
+        {
+            *out++ = m_palette[ word & m_index_mask ];
+            word >>= m_index_bits;
+        }
+    }
+} // PaletteStorage::decode
+
+void
+PaletteStorage::encode( std::span<const BlockID> blocks )
+{
+    assert( blocks.size() == m_size );
+
+    m_palette.clear();
+
+    // Blocks usually come in long runs, so remember the last lookup
+    auto last_id = BlockID::k_max;
+    for ( auto block_id : blocks )
+    {
+        if ( block_id != last_id && std::find( m_palette.begin(), m_palette.end(), block_id ) == m_palette.end() )
+        {
+            m_palette.push_back( block_id );
+        }
+
+        last_id = block_id;
+    }
+
+    if ( m_palette.empty() )
+    {
+        m_palette.push_back( BlockID::k_none );
+    }
+
+    m_index_bits = 0;
+    repack( indexBitsFor( m_palette.size() ) );
+
+    if ( isUniform() )
+    {
+        return;
+    }
+
+    uint32_t palette_index = 0;
+    last_id = m_palette[ 0 ];
+
+    for ( std::size_t index = 0; index < m_size; ++index )
+    {
+        if ( blocks[ index ] != last_id )
+        {
+            last_id = blocks[ index ];
+            palette_index = static_cast<uint32_t>(
+                std::find( m_palette.begin(), m_palette.end(), last_id ) - m_palette.begin() );
+        }
+
+        writeIndex( index, palette_index );
+    }
+} // PaletteStorage::encode
+
+void
+PaletteStorage::shrinkToFit()
+{
+    if ( isUniform() )
+    {
+        m_palette.shrink_to_fit();
+        return;
+    }
+
+    auto blocks = std::vector<BlockID>( m_size );
+    decode( blocks );
+    encode( blocks );
+
+    m_palette.shrink_to_fit();
+} // PaletteStorage::shrinkToFit
+
+}; // namespace chunk
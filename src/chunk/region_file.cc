@@ -0,0 +1,371 @@
+#include "chunk/region_file.h"
+#include "chunk/chunk_codec.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace chunk
+{
+
+namespace
+{
+
+// Numbers of the header are little endian
+template <typename T>
+void
+storeLittleEndian( char* bytes, T value )
+{
+    for ( std::size_t byte = 0; byte < sizeof( T ); byte++ )
+    {
+        bytes[ byte ] = static_cast<char>( ( value >> ( 8 * byte ) ) & 0xff );
+    }
+}
+
+template <typename T>
+T
+loadLittleEndian( const uint8_t* bytes )
+{
+    T value = 0;
+
+    for ( std::size_t byte = 0; byte < sizeof( T ); byte++ )
+    {
+        value |= static_cast<T>( bytes[ byte ] ) << ( 8 * byte );
+    }
+
+    return value;
+}
+
+std::string
+getRegionFileName( const pos::ChunkPos& region_pos )
+{
+    return "r." + std::to_string( region_pos.x ) + "." + std::to_string( region_pos.y ) + ".mcr";
+}
+
+} // namespace
+
+RegionFile::RegionFile( std::filesystem::path path )
+    : m_path( std::move( path ) )
+{
+    if ( !std::filesystem::exists( m_path ) )
+    {
+        return;
+    }
+
+    m_mapping.emplace( m_path );
+
+    // The file without the whole header has no chunks, it's created again on the first write
+    if ( m_mapping->getSize() < k_header_size )
+    {
+        m_mapping.reset();
+        std::filesystem::remove( m_path );
+        return;
+    }
+
+    readHeader();
+} // RegionFile::RegionFile
+
+std::size_t
+RegionFile::getLocalIndex( const pos::ChunkPos& chunk_pos )
+{
+    const auto region_pos = getRegionPos( chunk_pos );
+    const auto local_x = chunk_pos.x - region_pos.x * k_region_side;
+    const auto local_y = chunk_pos.y - region_pos.y * k_region_side;
+
+    return static_cast<std::size_t>( local_x * k_region_side + local_y );
+} // RegionFile::getLocalIndex
+
+bool
+RegionFile::hasChunk( const pos::ChunkPos& chunk_pos ) const
+{
+    auto lock = std::shared_lock{ m_mutex };
+    return m_table[ getLocalIndex( chunk_pos ) ].offset != 0;
+} // RegionFile::hasChunk
+
+bool
+RegionFile::loadChunk( Chunk& chunk )
+{
+    const auto index = getLocalIndex( chunk.getPosition() );
+    auto lock = std::shared_lock{ m_mutex };
+
+    if ( m_table[ index ].offset == 0 )
+    {
+        return false;
+    }
+
+    // The chunk was written after the file had been mapped
+    if ( !isMapped( m_table[ index ] ) )
+    {
+        lock.unlock();
+
+        {
+            auto unique_lock = std::unique_lock{ m_mutex };
+            if ( !isMapped( m_table[ index ] ) )
+            {
+                m_mapping.emplace( m_path );
+            }
+        }
+
+        lock.lock();
+    }
+
+    const auto& entry = m_table[ index ];
+    return decompressChunk( m_mapping->getData().subspan( entry.offset, entry.size ), chunk );
+} // RegionFile::loadChunk
+
+void
+RegionFile::prefetchChunks( std::span<const pos::ChunkPos> positions ) const
+{
+    const auto region_pos = getRegionPos( positions.empty() ? pos::ChunkPos{} : positions.front() );
+    auto lock = std::shared_lock{ m_mutex };
+
+    // Neighbour chunks are usually saved together, so the ranges of the chunks are merged
+    // to read them ahead with a few large requests
+    std::vector<TableEntry> entries;
+
+    for ( const auto& position : positions )
+    {
+        const auto& entry = m_table[ getLocalIndex( position ) ];
+
+        if ( getRegionPos( position ) == region_pos && isMapped( entry ) && entry.offset != 0 )
+        {
+            entries.push_back( entry );
+        }
+    }
+
+    std::sort( entries.begin(), entries.end(), []( const TableEntry& lhs, const TableEntry& rhs ) {
+        return lhs.offset < rhs.offset;
+    } );
+
+    for ( auto current = entries.begin(); current != entries.end(); )
+    {
+        const auto begin = current->offset;
+        auto end = current->offset + current->size;
+
+        for ( ++current; current != entries.end() && current->offset <= end + k_prefetch_gap; ++current )
+        {
+            end = std::max<uint64_t>( end, current->offset + current->size );
+        }
+
+        m_mapping->prefetch( begin, end - begin );
+    }
+} // RegionFile::prefetchChunks
+
+void
+RegionFile::writeChunk( const pos::ChunkPos& chunk_pos, std::span<const uint8_t> data )
+{
+    auto lock = std::unique_lock{ m_mutex };
+
+    if ( !m_file.is_open() )
+    {
+        if ( !std::filesystem::exists( m_path ) )
+        {
+            createFile();
+        }
+
+        m_file.open( m_path, std::ios::in | std::ios::out | std::ios::binary );
+    }
+
+    const auto index = getLocalIndex( chunk_pos );
+
+    m_file.seekp( 0, std::ios::end );
+    const auto offset = static_cast<uint64_t>( m_file.tellp() );
+    m_file.write( reinterpret_cast<const char*>( data.data() ), static_cast<std::streamsize>( data.size() ) );
+
+    // The entry is changed after the data is written, so the chunk is never pointing to the incomplete data
+    m_table[ index ] = TableEntry{ .offset = offset, .size = static_cast<uint32_t>( data.size() ) };
+    writeTableEntry( index );
+    m_file.flush();
+
+    if ( !m_file )
+    {
+        throw std::runtime_error( "Failed to write the region file " + m_path.string() );
+    }
+} // RegionFile::writeChunk
+
+void
+RegionFile::readHeader()
+{
+    const auto header = m_mapping->getData();
+
+    if ( !std::equal( k_magic.begin(), k_magic.end(), header.begin() ) ||
+         loadLittleEndian<uint32_t>( header.data() + k_magic.size() ) != k_version )
+    {
+        throw std::runtime_error( "Invalid region file " + m_path.string() );
+    }
+
+    for ( std::size_t index = 0; index < k_chunks_count; index++ )
+    {
+        const auto* entry = header.data() + k_table_offset + index * k_entry_size;
+
+        m_table[ index ] = TableEntry{
+            .offset = loadLittleEndian<uint64_t>( entry ),
+            .size = loadLittleEndian<uint32_t>( entry + sizeof( uint64_t ) ) };
+
+        // Entries pointing out of the file are treated as not saved chunks
+        if ( m_table[ index ].offset + m_table[ index ].size > header.size() )
+        {
+            m_table[ index ] = TableEntry{};
+        }
+    }
+} // RegionFile::readHeader
+
+void
+RegionFile::createFile()
+{
+    auto header = std::vector<char>( k_header_size, 0 );
+    std::copy( k_magic.begin(), k_magic.end(), header.begin() );
+    storeLittleEndian( header.data() + k_magic.size(), k_version );
+
+    // The header is written next to the file and renamed, so the process dying halfway leaves no broken file
+    auto temporary_path = m_path;
+    temporary_path += ".tmp";
+
+    {
+        auto file = std::ofstream{ temporary_path, std::ios::binary | std::ios::trunc };
+        file.write( header.data(), static_cast<std::streamsize>( header.size() ) );
+        file.flush();
+
+        if ( !file )
+        {
+            throw std::runtime_error( "Failed to create the region file " + temporary_path.string() );
+        }
+    }
+
+    std::filesystem::rename( temporary_path, m_path );
+} // RegionFile::createFile
+
+void
+RegionFile::writeTableEntry( std::size_t index )
+{
+    std::array<char, k_entry_size> entry{};
+    storeLittleEndian( entry.data(), m_table[ index ].offset );
+    storeLittleEndian( entry.data() + sizeof( uint64_t ), m_table[ index ].size );
+
+    m_file.seekp( static_cast<std::streamoff>( k_table_offset + index * k_entry_size ) );
+    m_file.write( entry.data(), static_cast<std::streamsize>( entry.size() ) );
+} // RegionFile::writeTableEntry
+
+RegionStorage::RegionStorage( std::filesystem::path directory, uint32_t seed )
+    : m_directory( std::move( directory ) ),
+      m_seed( seed )
+{
+    std::filesystem::create_directories( m_directory );
+
+    if ( !readMetadata() )
+    {
+        writeMetadata();
+    }
+} // RegionStorage::RegionStorage
+
+bool
+RegionStorage::readMetadata()
+{
+    const auto path = m_directory / k_metadata_file_name;
+
+    if ( !std::filesystem::exists( path ) )
+    {
+        return false;
+    }
+
+    std::array<uint8_t, k_metadata_size> metadata{};
+
+    auto file = std::ifstream{ path, std::ios::binary };
+    file.read( reinterpret_cast<char*>( metadata.data() ), static_cast<std::streamsize>( metadata.size() ) );
+
+    // The file is replaced at once, so it's never incomplete. The seed of the broken one is lost with the world
+    if ( !file || !std::equal( k_metadata_magic.begin(), k_metadata_magic.end(), metadata.begin() ) ||
+         loadLittleEndian<uint32_t>( metadata.data() + k_metadata_magic.size() ) != k_metadata_version )
+    {
+        throw std::runtime_error( "Invalid world metadata " + path.string() );
+    }
+
+    m_seed = loadLittleEndian<uint32_t>( metadata.data() + k_metadata_magic.size() + sizeof( uint32_t ) );
+    return true;
+} // RegionStorage::readMetadata
+
+void
+RegionStorage::writeMetadata() const
+{
+    std::array<char, k_metadata_size> metadata{};
+    std::copy( k_metadata_magic.begin(), k_metadata_magic.end(), metadata.begin() );
+    storeLittleEndian( metadata.data() + k_metadata_magic.size(), k_metadata_version );
+    storeLittleEndian( metadata.data() + k_metadata_magic.size() + sizeof( uint32_t ), m_seed );
+
+    // The metadata is written next to the old one and renamed, so the process dying halfway leaves no broken file
+    const auto path = m_directory / k_metadata_file_name;
+    auto temporary_path = path;
+    temporary_path += ".tmp";
+
+    {
+        auto file = std::ofstream{ temporary_path, std::ios::binary | std::ios::trunc };
+        file.write( metadata.data(), static_cast<std::streamsize>( metadata.size() ) );
+        file.flush();
+
+        if ( !file )
+        {
+            throw std::runtime_error( "Failed to write the world metadata " + temporary_path.string() );
+        }
+    }
+
+    std::filesystem::rename( temporary_path, path );
+} // RegionStorage::writeMetadata
+
+bool
+RegionStorage::loadChunk( Chunk& chunk )
+{
+    return getRegionFile( chunk.getPosition() )->loadChunk( chunk );
+} // RegionStorage::loadChunk
+
+void
+RegionStorage::prefetchChunks( std::span<const pos::ChunkPos> positions )
+{
+    // Positions of the same region go one after another, when the region is walked in one direction
+    for ( auto begin = positions.begin(); begin != positions.end(); )
+    {
+        const auto region_pos = RegionFile::getRegionPos( *begin );
+        const auto end = std::find_if( begin, positions.end(), [ &region_pos ]( const pos::ChunkPos& position ) {
+            return RegionFile::getRegionPos( position ) != region_pos;
+        } );
+
+        getRegionFile( *begin )->prefetchChunks( std::span{ begin, end } );
+        begin = end;
+    }
+} // RegionStorage::prefetchChunks
+
+void
+RegionStorage::saveChunk( const Chunk& chunk )
+{
+    saveCompressedChunk( chunk.getPosition(), compressChunk( chunk ) );
+} // RegionStorage::saveChunk
+
+void
+RegionStorage::saveCompressedChunk( const pos::ChunkPos& position, std::span<const uint8_t> data )
+{
+    getRegionFile( position )->writeChunk( position, data );
+} // RegionStorage::saveCompressedChunk
+
+std::shared_ptr<RegionFile>
+RegionStorage::getRegionFile( const pos::ChunkPos& chunk_pos )
+{
+    const auto region_pos = RegionFile::getRegionPos( chunk_pos );
+    auto lock = std::lock_guard{ m_mutex };
+
+    if ( auto found = m_regions.find( region_pos ); found != m_regions.end() )
+    {
+        return found->second;
+    }
+
+    // Close the files nobody uses. The file in use is kept, so that it never has two instances writing to it
+    if ( m_regions.size() >= k_max_opened_regions )
+    {
+        std::erase_if( m_regions, []( const auto& region ) { return region.second.use_count() == 1; } );
+    }
+
+    auto region_file = std::make_shared<RegionFile>( m_directory / getRegionFileName( region_pos ) );
+    m_regions.emplace( region_pos, region_file );
+
+    return region_file;
+} // RegionStorage::getRegionFile
+
+}; // namespace chunk
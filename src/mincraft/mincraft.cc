@@ -17,6 +17,9 @@
 
 #include "chunk/chunk_man.h"
 #include "chunk/chunk_mesher.h"
+#include "chunk/edit_transaction.h"
+#include "chunk/job_system.h"
+#include "chunk/mesh_registry.h"
 
 #include "glfw/input/keyboard.h"
 #include "glfw/input/mouse.h"
@@ -44,13 +47,18 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cassert>
+#include <cmath>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
 #include <iterator>
 #include <numeric>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 namespace
@@ -61,7 +69,12 @@ struct UniformBufferObject
     glm::mat4 model = {};
     glm::mat4 view = {};
     glm::mat4 proj = {};
-    glm::vec2 origin_pos = {};
+};
+
+// Position of the drawn chunk, the vertices of its mesh are relative to the chunk
+struct ChunkPushConstants
+{
+    glm::ivec2 chunk_pos = {};
 };
 
 struct DebugCallback
@@ -115,6 +128,11 @@ struct AppOptions
 {
     bool validation = false;
     bool uncapped_fps = false;
+    int render_distance = chunk::ChunkMan::k_default_render_distance;
+    std::string world_path = "world";
+    std::size_t cache_budget_mb = chunk::ChunkMan::k_default_cache_budget_mb;
+    bool greedy_mesher = false;
+    bool quad_meshes = false;
 };
 
 namespace po = boost::program_options;
@@ -125,7 +143,20 @@ parseOptions( std::span<const char*> command_line_args )
     po::options_description desc( "Available options" );
     desc.add_options()( "help,h", "Print this help message" )( "debug,d", "Use validation layers" )(
         "uncap,u",
-        "Uncapped fps always" );
+        "Uncapped fps always" )(
+        "render-distance,r",
+        po::value<int>()->default_value( chunk::ChunkMan::k_default_render_distance ),
+        "Render distance in chunks" )(
+        "world,w",
+        po::value<std::string>()->default_value( "world" ),
+        "Directory the world is saved to, empty to not save it" )(
+        "cache-mb,c",
+        po::value<std::size_t>()->default_value( chunk::ChunkMan::k_default_cache_budget_mb ),
+        "Memory budget of the chunks that left the render area ( in MegaBytes )" )(
+        "greedy-mesher,g",
+        "Mesh the chunks block by block instead of the binary mesher" )(
+        "quad-meshes,q",
+        "Store one record per face and make its vertices in the vertex shader" );
 
     po::variables_map v_map;
     po::store( po::parse_command_line( command_line_args.size(), command_line_args.data(), desc ), v_map );
@@ -146,8 +177,25 @@ parseOptions( std::span<const char*> command_line_args )
 #endif
 
     const bool uncapped = v_map.count( "uncap" );
+    const int render_distance = v_map[ "render-distance" ].as<int>();
+
+    if ( render_distance < chunk::ChunkMan::k_min_render_distance ||
+         render_distance > chunk::ChunkMan::k_max_render_distance )
+    {
+        throw std::runtime_error{ fmt::format(
+            "Render distance should be in range [{}, {}]",
+            chunk::ChunkMan::k_min_render_distance,
+            chunk::ChunkMan::k_max_render_distance ) };
+    }
 
-    return AppOptions{ .validation = validation, .uncapped_fps = uncapped };
+    return AppOptions{
+        .validation = validation,
+        .uncapped_fps = uncapped,
+        .render_distance = render_distance,
+        .world_path = v_map[ "world" ].as<std::string>(),
+        .cache_budget_mb = v_map[ "cache-mb" ].as<std::size_t>(),
+        .greedy_mesher = static_cast<bool>( v_map.count( "greedy-mesher" ) ),
+        .quad_meshes = static_cast<bool>( v_map.count( "quad-meshes" ) ) };
 }
 
 vkwrap::PhysicalDevice
@@ -495,26 +543,66 @@ createDeviceLocalBuffer(
     return buffer;
 }
 
-vkwrap::Buffer
-createVertexBuffer( ranges::range auto&& queues, const chunk::ChunkMesher& mesher, vkwrap::Mman& manager )
+// Buffers of the mesh of one chunk. Chunks without faces have no buffers. Quads are drawn without the index buffer.
+// Ranges of the faces of every direction are kept to skip the ones turned away from the camera
+struct ChunkBuffers
+{
+    vkwrap::Buffer vertex_buffer;
+    std::optional<vkwrap::Buffer> index_buffer;
+    vk::IndexType index_type;
+    uint32_t indices_count;
+    uint32_t quads_count;
+    std::array<chunk::ChunkMesher::FaceRange, chunk::ChunkMesher::k_directions_count> face_ranges;
+    chunk::ChunkMesher::Bounds bounds;
+};
+
+using RegionBuffers = std::unordered_map<pos::ChunkPos, ChunkBuffers>;
+
+ChunkBuffers
+createChunkBuffers( ranges::range auto&& queues, const chunk::MeshRegistry::ChunkMesh& mesh, vkwrap::Mman& manager )
 {
-    auto memory = std::span{ mesher.getVerticesData(), mesher.getVerticesCount() };
-    return createDeviceLocalBuffer(
-        queues,
-        memory,
-        manager,
-        vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst );
+    assert( !mesh.isEmpty() );
+
+    if ( !mesh.quads.empty() )
+    {
+        return ChunkBuffers{
+            .vertex_buffer =
+                createDeviceLocalBuffer( queues, mesh.quads, manager, vk::BufferUsageFlagBits::eVertexBuffer ),
+            .index_buffer = std::nullopt,
+            .index_type = chunk::ChunkMesher::k_index_type,
+            .indices_count = 0,
+            .quads_count = static_cast<uint32_t>( mesh.quads.size() ),
+            .face_ranges = mesh.face_ranges,
+            .bounds = mesh.bounds };
+    }
+
+    return ChunkBuffers{
+        .vertex_buffer =
+            createDeviceLocalBuffer( queues, mesh.vertices, manager, vk::BufferUsageFlagBits::eVertexBuffer ),
+        .index_buffer = mesh.wide_indices.empty()
+            ? createDeviceLocalBuffer( queues, mesh.indices, manager, vk::BufferUsageFlagBits::eIndexBuffer )
+            : createDeviceLocalBuffer( queues, mesh.wide_indices, manager, vk::BufferUsageFlagBits::eIndexBuffer ),
+        .index_type = mesh.getIndexType(),
+        .indices_count = static_cast<uint32_t>( mesh.getIndicesCount() ),
+        .quads_count = 0,
+        .face_ranges = mesh.face_ranges,
+        .bounds = mesh.bounds };
 }
 
-vkwrap::Buffer
-createIndexBuffer( ranges::range auto&& queues, const chunk::ChunkMesher& mesher, vkwrap::Mman& manager )
+RegionBuffers
+createRegionBuffers( ranges::range auto&& queues, const chunk::MeshRegistry& registry, vkwrap::Mman& manager )
 {
-    auto memory = std::span{ mesher.getIndicesData(), mesher.getIndicesCount() };
-    return createDeviceLocalBuffer(
-        queues,
-        memory,
-        manager,
-        vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst );
+    auto buffers = RegionBuffers{};
+
+    for ( const auto& [ position, mesh ] : registry.getMeshes() )
+    {
+        if ( !mesh.isEmpty() )
+        {
+            buffers.emplace( position, createChunkBuffers( queues, mesh, manager ) );
+        }
+    }
+
+    return buffers;
 }
 
 auto
@@ -594,6 +682,8 @@ createKeyboardReader( GLFWwindow* window )
         GLFW_KEY_C,
         GLFW_KEY_Q,
         GLFW_KEY_E,
+        GLFW_KEY_F,
+        GLFW_KEY_R,
         GLFW_KEY_LEFT_ALT } );
     return keyboard;
 }
@@ -678,6 +768,7 @@ createAndUpdateDescriptorSets(
 struct GuiConfiguation
 {
     bool draw_lines;
+    int render_distance;
 };
 
 class MasterGui
@@ -687,12 +778,27 @@ class MasterGui
     {
         ImGui::Begin( "Configuration" );
         ImGui::Checkbox( "Draw lines", &m_config.draw_lines );
+
+        ImGui::SliderInt(
+            "Render distance",
+            &m_render_distance_edit,
+            chunk::ChunkMan::k_min_render_distance,
+            chunk::ChunkMan::k_max_render_distance );
+
+        // Resizing the world is expensive, so apply the value only when the slider is released
+        if ( ImGui::IsItemDeactivatedAfterEdit() )
+        {
+            m_config.render_distance = m_render_distance_edit;
+        }
+
         ImGui::End();
     }
 
   public:
-    MasterGui( vk::Instance instance, vk::SurfaceKHR surface )
-        : m_vkinfo_tab{ instance, surface }
+    MasterGui( vk::Instance instance, vk::SurfaceKHR surface, int render_distance )
+        : m_vkinfo_tab{ instance, surface },
+          m_config{ .draw_lines = false, .render_distance = render_distance },
+          m_render_distance_edit{ render_distance }
     {
     }
 
@@ -706,7 +812,8 @@ class MasterGui
 
   private:
     imgw::VulkanInfoTab m_vkinfo_tab;
-    GuiConfiguation m_config{};
+    GuiConfiguation m_config;
+    int m_render_distance_edit;
 };
 
 constexpr auto k_subpass_dependency = vk::SubpassDependency{
@@ -729,13 +836,67 @@ constexpr auto k_pool_sizes = std::array{
 auto
 meshChunks()
 {
-    auto mesher_future = std::async( std::launch::async, []() {
-        chunk::ChunkMesher mesher;
-        mesher.meshRenderArea();
-        return mesher;
+    // The task only waits for the jobs of generation and meshing, so it's run on the pool as well
+    auto registry_future = chunk::JobSystem::getRef().submitTask( []() {
+        chunk::MeshRegistry registry;
+        registry.applyUpdate( registry.collectUpdate() );
+        return registry;
     } );
 
-    return mesher_future;
+    return registry_future;
+}
+
+// Region of the world that should be generated and meshed
+struct WorldTarget
+{
+    pos::ChunkPos origin_pos;
+    int render_distance;
+
+    friend bool operator==( const WorldTarget& lhs, const WorldTarget& rhs ) = default;
+};
+
+// Block changed by the player, edits are applied by the world update
+struct BlockEdit
+{
+    pos::BlockPos position;
+    chunk::BlockID block_id;
+};
+
+// The registry is only read by the task, it's not changed until the task is finished
+auto
+updateWorld( WorldTarget target, std::vector<BlockEdit> edits, const chunk::MeshRegistry& registry )
+{
+    auto update_task = [ target, edits = std::move( edits ), &registry ]() {
+        auto& chunk_man = chunk::ChunkMan::getRef();
+
+        // Shrink the region before moving it and grow it after, so that no extra chunks are generated
+        if ( target.render_distance < chunk_man.getRenderDistance() )
+        {
+            chunk_man.setRenderDistance( target.render_distance );
+        }
+
+        chunk_man.changeOriginPos( target.origin_pos );
+
+        if ( target.render_distance != chunk_man.getRenderDistance() )
+        {
+            chunk_man.setRenderDistance( target.render_distance );
+        }
+
+        // Edits made between the updates are applied at once, the touched chunks are remeshed once
+        chunk::EditTransaction transaction;
+
+        for ( const auto& edit : edits )
+        {
+            transaction.fillBox( edit.position, edit.position, edit.block_id );
+        }
+
+        transaction.commit();
+
+        // Only the new and the edited chunks ( and their neighbours ) are meshed, the rest of the meshes are kept
+        return registry.collectUpdate();
+    };
+
+    return chunk::JobSystem::getRef().submitTask( std::move( update_task ) );
 }
 
 struct PipelineCreateResult
@@ -751,9 +912,19 @@ createPipeline(
     vk::RenderPass render_pass,
     vk::PolygonMode mode )
 {
-    auto pipeline_layout = vkwrap::createPipelineLayout( logical_device, std::array{ set_layout } );
+    const auto push_constant_ranges = std::array{ vk::PushConstantRange{
+        .stageFlags = vk::ShaderStageFlagBits::eVertex,
+        .offset = 0,
+        .size = sizeof( ChunkPushConstants ) } };
 
-    auto vert_shader_module = vkwrap::ShaderModule{ "vertex_shader.spv", logical_device };
+    auto pipeline_layout =
+        vkwrap::createPipelineLayout( logical_device, std::array{ set_layout }, push_constant_ranges );
+
+    // Quads are expanded to the vertices by the variant of the vertex shader compiled with QUAD_FORMAT
+    const auto is_quad_format = ( chunk::ChunkMesher::getMeshFormat() == chunk::ChunkMesher::MeshFormat::k_quads );
+    const auto vert_shader_path = is_quad_format ? "quad_vertex_shader.spv" : "vertex_shader.spv";
+
+    auto vert_shader_module = vkwrap::ShaderModule{ vert_shader_path, logical_device };
     auto frag_shader_module = vkwrap::ShaderModule{ "fragment_shader.spv", logical_device };
     auto vertex_info = chunk::ChunkMesher::getVertexInfo();
 
@@ -794,6 +965,7 @@ struct RenderConfig
 {
     UniformBufferObject ubo;
     bool draw_lines;
+    int render_distance;
 };
 
 class MinCraftApplication
@@ -881,8 +1053,11 @@ class MinCraftApplication
     explicit MinCraftApplication( AppOptions options )
         : vk_instance{ createInstance( glfw_instance, options.validation ) },
           physical_device{ initializePhysicalDevice( options ) },
-          swapchain{ initializeSwapchain( options ) }
+          swapchain{ initializeSwapchain( options ) },
+          mesh_target{ .origin_pos = pos::ChunkPos{}, .render_distance = options.render_distance },
+          gui{ vk_instance.instance.get(), surface.get(), options.render_distance }
     {
+        mesh_registry.markUploaded();
     }
 
   private:
@@ -953,13 +1128,8 @@ class MinCraftApplication
         camera.rotate( resulting_rotation );
 
         auto [ view, proj ] = camera.getMatrices( extent.width, extent.height );
-        auto [ x, y ] = mesher.getRenderAreaRight();
 
-        auto ubo = UniformBufferObject{
-            .model = glm::mat4x4{ 1.0f },
-            .view = view,
-            .proj = proj,
-            .origin_pos = glm::vec2{ x, y } };
+        auto ubo = UniformBufferObject{ .model = glm::mat4x4{ 1.0f }, .view = view, .proj = proj };
 
         return ubo;
     };
@@ -972,10 +1142,125 @@ class MinCraftApplication
 
         auto config = gui.draw(); // Get configuration and pass it to physicsLoop; TODO [Sergei]
         auto ubo = physicsLoop( extent, delta_time.count() );
+        readBlockEdit();
 
-        return RenderConfig{ ubo, config.draw_lines };
+        return RenderConfig{ ubo, config.draw_lines, config.render_distance };
     };
 
+    // Chunk the camera is in, the world is streamed around it
+    pos::ChunkPos getCameraChunkPos() const
+    {
+        auto to_chunk_coord = []( float coord ) {
+            return static_cast<int>( std::floor( coord / chunk::Chunk::k_max_width_length ) );
+        };
+
+        return pos::ChunkPos{ to_chunk_coord( camera.position.x ), to_chunk_coord( camera.position.y ) };
+    }
+
+    // Break ( F ) or place ( R ) the block in front of the camera, once per key press
+    void readBlockEdit()
+    {
+        constexpr auto k_edit_distance = 4.0f;
+
+        const bool use_keyboard = !ImGui::GetIO().WantCaptureKeyboard;
+        const bool is_breaking = use_keyboard && keyboard.isPressed( GLFW_KEY_F );
+        const bool is_placing = use_keyboard && keyboard.isPressed( GLFW_KEY_R );
+        const bool is_editing = is_breaking || is_placing;
+
+        if ( is_editing && !was_editing )
+        {
+            const auto target = glm::floor( camera.position + camera.getDir() * k_edit_distance );
+
+            pending_edits.push_back( BlockEdit{
+                .position = pos::BlockPos{ static_cast<int>( target.x ),
+                                           static_cast<int>( target.y ),
+                                           static_cast<int>( target.z ) },
+                .block_id = is_breaking ? chunk::BlockID::k_none : chunk::BlockID::k_dirt } );
+        }
+
+        was_editing = is_editing;
+    }
+
+    void retireBuffer( vkwrap::Buffer buffer )
+    {
+        retired_buffers.push_back( RetiredBuffer{ .buffer = std::move( buffer ), .retire_frame = frames_count } );
+    }
+
+    // Buffers of the chunk could be used by the frames in flight, so they are released later
+    void retireChunkBuffers( const pos::ChunkPos& position )
+    {
+        auto found = chunk_buffers.find( position );
+
+        if ( found == chunk_buffers.end() )
+        {
+            return;
+        }
+
+        retireBuffer( std::move( found->second.vertex_buffer ) );
+
+        if ( found->second.index_buffer )
+        {
+            retireBuffer( std::move( *found->second.index_buffer ) );
+        }
+
+        chunk_buffers.erase( found );
+    }
+
+    // Take the world update made in the background if it is ready. Every remeshed chunk gets new buffers,
+    // the buffers of the rest of the chunks are kept
+    void swapRemeshedWorld()
+    {
+        if ( !remesh_future.valid() ||
+             remesh_future.wait_for( std::chrono::seconds{ 0 } ) != std::future_status::ready )
+        {
+            return;
+        }
+
+        auto update = remesh_future.get();
+
+        for ( const auto& position : update.removed )
+        {
+            retireChunkBuffers( position );
+        }
+
+        for ( const auto& mesh : update.meshes )
+        {
+            retireChunkBuffers( mesh.position );
+
+            if ( !mesh.isEmpty() )
+            {
+                chunk_buffers.emplace( mesh.position, createChunkBuffers( queues(), mesh, memory_manager ) );
+            }
+        }
+
+        mesh_registry.applyUpdate( std::move( update ) );
+        mesh_registry.markUploaded();
+    }
+
+    // Release the buffers that no frame in flight uses. Called after waiting for the fence of the current frame
+    void releaseRetiredBuffers()
+    {
+        while ( !retired_buffers.empty() &&
+                retired_buffers.front().retire_frame + k_max_frames_in_flight <= frames_count )
+        {
+            retired_buffers.pop_front();
+        }
+    }
+
+    // Start updating the world in the background if the camera crossed a chunk border, the render distance
+    // was changed or some blocks were edited. Only one update runs at once, the latest target and the edits
+    // made meanwhile are picked up when it finishes, so the requests in between are coalesced
+    void streamWorld( WorldTarget target )
+    {
+        if ( remesh_future.valid() || ( target == mesh_target && pending_edits.empty() ) )
+        {
+            return;
+        }
+
+        remesh_future = updateWorld( target, std::exchange( pending_edits, {} ), mesh_registry );
+        mesh_target = target;
+    }
+
     auto recreateSwapchainWrapped()
     {
         logical_device->waitIdle();
@@ -990,6 +1275,7 @@ class MinCraftApplication
         auto& command_buffer = render_infos.imgui_command_buffers.at( current_frame );
         [[maybe_unused]] auto res =
             logical_device->waitForFences( current_frame_data.in_flight_fence.get(), VK_TRUE, UINT64_MAX );
+        releaseRetiredBuffers();
 
         const auto extent = swapchain.getExtent();
         auto& uniform_buffer = render_infos.uniform_buffers.at( current_frame );
@@ -1030,6 +1316,7 @@ class MinCraftApplication
         }
 
         current_frame = ( current_frame + 1 ) % k_max_frames_in_flight;
+        frames_count++;
     };
 
     void fillCommandBuffer( vk::CommandBuffer& cmd, uint32_t image_index, vk::Extent2D extent, RenderConfig config )
@@ -1055,9 +1342,6 @@ class MinCraftApplication
             vk::PipelineBindPoint::eGraphics,
             ( config.draw_lines ? line_pipeline.pipeline : fill_pipeline.pipeline ) );
 
-        cmd.bindVertexBuffers( 0, vertex_buffer.get(), vk::DeviceSize{ 0 } );
-        cmd.bindIndexBuffer( index_buffer.get(), 0, chunk::ChunkMesher::k_index_type );
-
         // Negative viewport coordinates. This is quite legal and well-formed. See
         // https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VK_KHR_maintenance1.html
         // This is used to flip the coordinate system without modifying the transformation matrices
@@ -1068,14 +1352,76 @@ class MinCraftApplication
         cmd.setViewport( 0, viewport );
         cmd.setScissor( 0, scissor );
 
+        const auto pipeline_layout = ( config.draw_lines ? line_pipeline.layout : fill_pipeline.layout ).get();
+
         cmd.bindDescriptorSets(
             vk::PipelineBindPoint::eGraphics,
-            ( config.draw_lines ? line_pipeline.layout : fill_pipeline.layout ).get(),
+            pipeline_layout,
             0,
             descriptor_sets.at( current_frame ).get(),
             {} );
 
-        cmd.drawIndexed( static_cast<uint32_t>( mesher.getIndicesCount() ), 1, 0, 0, 0 );
+        // Every chunk is drawn with its own buffers, the vertex shader moves the mesh to the chunk
+        for ( const auto& [ position, buffers ] : chunk_buffers )
+        {
+            const auto push_constants = ChunkPushConstants{ .chunk_pos = glm::ivec2{ position.x, position.y } };
+
+            cmd.pushConstants<ChunkPushConstants>(
+                pipeline_layout,
+                vk::ShaderStageFlagBits::eVertex,
+                0,
+                push_constants );
+
+            cmd.bindVertexBuffers( 0, buffers.vertex_buffer.get(), vk::DeviceSize{ 0 } );
+
+            if ( buffers.index_buffer )
+            {
+                cmd.bindIndexBuffer( buffers.index_buffer->get(), 0, buffers.index_type );
+            }
+
+            // every quad is an instance of the 6 vertices made by the vertex shader
+            const auto draw_range = [ &cmd, &buffers ]( uint32_t first, uint32_t count ) {
+                if ( !buffers.index_buffer )
+                {
+                    cmd.draw( chunk::ChunkMesher::k_quad_vertices_count, count, 0, first );
+                    return;
+                }
+
+                // indices are relative to the first vertex of the vertex buffer of the chunk
+                constexpr int32_t k_base_vertex = 0;
+                cmd.drawIndexed( count, 1, first, k_base_vertex, 0 );
+            };
+
+            // Faces turned away from the camera are skipped, neighbour ranges of the visible ones are drawn at once
+            uint32_t first = 0;
+            uint32_t count = 0;
+
+            for ( std::size_t direction = 0; direction < chunk::ChunkMesher::k_directions_count; direction++ )
+            {
+                const auto& range = buffers.face_ranges[ direction ];
+                const auto& eye = camera.position;
+
+                if ( range.count == 0 || !buffers.bounds.isFacing( direction, eye.x, eye.y, eye.z ) )
+                {
+                    continue;
+                }
+
+                if ( count != 0 && first + count != range.first )
+                {
+                    draw_range( first, count );
+                    count = 0;
+                }
+
+                first = ( count == 0 ) ? range.first : first;
+                count += range.count;
+            }
+
+            if ( count != 0 )
+            {
+                draw_range( first, count );
+            }
+        }
+
         imgui_resources.fillCommandBuffer( cmd );
 
         cmd.endRenderPass();
@@ -1085,20 +1431,33 @@ class MinCraftApplication
   public:
     void drawLoop()
     {
+        swapRemeshedWorld();
         imgui_resources.newFrame();
-        auto ubo = appLoop( swapchain.getExtent() );
+        auto config = appLoop( swapchain.getExtent() );
         imgui_resources.renderFrame();
-        renderFrame( ubo );
+        streamWorld( WorldTarget{ .origin_pos = getCameraChunkPos(), .render_distance = config.render_distance } );
+        renderFrame( config );
     };
 
-    void shutDown() { logical_device->waitIdle(); }
+    void shutDown()
+    {
+        logical_device->waitIdle();
+
+        // The world can be changed only by the world update, so it's finished before saving
+        if ( remesh_future.valid() )
+        {
+            remesh_future.wait();
+        }
+
+        chunk::ChunkMan::getRef().saveChunks();
+    }
     bool running() const { return window.running(); }
 
   private:
     using HighResTimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
 
   private:
-    std::future<chunk::ChunkMesher> mesher_future = meshChunks();
+    std::future<chunk::MeshRegistry> registry_future = meshChunks();
     glfw::Instance glfw_instance = {};
     CreateInstanceResult vk_instance;
 
@@ -1139,17 +1498,32 @@ class MinCraftApplication
     vkwrap::DescriptorPool descriptor_pool = vkwrap::DescriptorPool{ logical_device, k_pool_sizes };
     UniqueDescriptorSets descriptor_sets = initializeDescriptorSets();
 
-    chunk::ChunkMesher mesher = mesher_future.get();
-    vkwrap::Buffer vertex_buffer = createVertexBuffer( queues(), mesher, memory_manager );
-    vkwrap::Buffer index_buffer = createIndexBuffer( queues(), mesher, memory_manager );
+    chunk::MeshRegistry mesh_registry = registry_future.get();
+    RegionBuffers chunk_buffers = createRegionBuffers( queues(), mesh_registry, memory_manager );
+
+    // Region of the current ( or being built ) mesh
+    WorldTarget mesh_target;
+    std::future<chunk::MeshRegistry::MeshUpdate> remesh_future;
+
+    std::vector<BlockEdit> pending_edits;
+    bool was_editing = false;
+
+    struct RetiredBuffer
+    {
+        vkwrap::Buffer buffer;
+        uint64_t retire_frame;
+    };
+
+    std::deque<RetiredBuffer> retired_buffers;
 
     uint32_t current_frame = 0;
+    uint64_t frames_count = 0;
 
     utils3d::Camera camera = utils3d::Camera{ glm::vec3{ 0.0f, 0.0f, 32.0f } };
     glfw::input::KeyboardStateTracker keyboard = createKeyboardReader( window );
     HighResTimePoint prev_timepoint = std::chrono::high_resolution_clock::now();
 
-    MasterGui gui = MasterGui{ vk_instance.instance.get(), surface.get() };
+    MasterGui gui;
 };
 
 void
@@ -1165,6 +1539,20 @@ runApplication( std::span<const char*> command_line_args )
         return;
     }
 
+    chunk::ChunkMan::setInitialRenderDistance( options.render_distance );
+    chunk::ChunkMan::setWorldDirectory( options.world_path );
+    chunk::ChunkMan::setCacheBudget( options.cache_budget_mb );
+
+    if ( options.greedy_mesher )
+    {
+        chunk::ChunkMesher::setMeshingMode( chunk::ChunkMesher::MeshingMode::k_greedy );
+    }
+
+    if ( options.quad_meshes )
+    {
+        chunk::ChunkMesher::setMeshFormat( chunk::ChunkMesher::MeshFormat::k_quads );
+    }
+
     spdlog::cfg::load_env_levels();
     // Use `export SPDLOG_LEVEL=debug` to set maximum logging level
     // Or `export SPDLOG_LEVEL=warn` to print only warnings and errors